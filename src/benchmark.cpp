@@ -0,0 +1,613 @@
+﻿#include "benchmark.h"
+
+#include "blend.h"
+#include "block_cell.h"
+#include "cc.h"
+#include "cell.h"
+#include "frame_encoder.h"
+#include "layer_blending.h"
+#include "painter.h"
+#include "palette.h"
+#include "rng.h"
+#include "screen_size.h"
+#include "terminal.h"
+
+#include <array>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <optional>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <fmt\format.h>
+
+#ifndef _WIN32
+#include <cerrno>
+#include <fcntl.h>
+#include <termios.h>
+#include <unistd.h>
+#endif
+
+
+namespace {
+
+   [[nodiscard]] auto get_random_color(
+      const int min_value,
+      const int max_value
+   ) -> moo::RGB
+   {
+      std::uniform_int_distribution<> channel_dist(min_value, max_value);
+      return {
+         static_cast<unsigned char>(channel_dist(moo::get_rng())),
+         static_cast<unsigned char>(channel_dist(moo::get_rng())),
+         static_cast<unsigned char>(channel_dist(moo::get_rng()))
+      };
+   }
+
+
+   /// <summary>Block glyphs with light-on-dark colors that change every color_keep_period cells,
+   /// like in game::early_test()</summary>
+   [[nodiscard]] auto get_benchmark_cells(const int color_keep_period) -> moo::CellBuffer {
+      constexpr std::array<wchar_t, 6> glyphs{ L' ', L'▀', L'▄', L'▌', L'▐', L'█' };
+      std::uniform_int_distribution<size_t> glyph_dist(0, glyphs.size() - 1);
+      moo::CellBuffer cells;
+      moo::Cell cell{ L' ', get_random_color(128, 255), get_random_color(0, 127) };
+      for (size_t index = 0; index < moo::get_char_count(); ++index) {
+         if (index % color_keep_period == 0) {
+            cell.fg = get_random_color(128, 255);
+            cell.bg = get_random_color(0, 127);
+         }
+         cell.glyph = glyphs[glyph_dist(moo::get_rng())];
+         cells[index] = cell;
+      }
+      return cells;
+   }
+
+
+   /// <summary>The string building as it was before the UTF-8 path: to_wstring() for every channel,
+   /// wide glyphs</summary>
+   auto encode_wstring_reference(
+      const moo::CellBuffer& cells,
+      std::wstring& target
+   ) -> void
+   {
+      moo::RGB last_fg{ 255, 255, 255 };
+      moo::RGB last_bg{ 0, 0, 0 };
+      for (size_t index = 0; index < moo::get_char_count(); ++index) {
+         const moo::Cell& cell = cells[index];
+         if (cell.bg != last_bg) {
+            moo::insert_color_string(cell.bg, moo::Layer::Back, target);
+            last_bg = cell.bg;
+         }
+         if (cell.has_fg() && cell.fg != last_fg) {
+            moo::insert_color_string(cell.fg, moo::Layer::Front, target);
+            last_fg = cell.fg;
+         }
+         target += cell.glyph;
+      }
+   }
+
+
+   template<typename T>
+   [[nodiscard]] auto get_average_microseconds(
+      const T& fun,
+      const int iterations
+   ) -> double
+   {
+      const auto start = std::chrono::steady_clock::now();
+      for (int i = 0; i < iterations; ++i)
+         fun();
+      const std::chrono::duration<double, std::micro> duration = std::chrono::steady_clock::now() - start;
+      return duration.count() / iterations;
+   }
+
+
+   auto run_encoding_benchmark() -> void {
+      constexpr int iterations = 500;
+      printf("String building, %i x %i cells, average of %i frames\n", moo::static_columns, moo::static_rows, iterations);
+      for (const int color_keep_period : { 1, 4, 16, 120 }) {
+         const moo::CellBuffer cells = get_benchmark_cells(color_keep_period);
+
+         std::wstring wide_str;
+         wide_str.reserve(moo::get_max_frame_size());
+         const double wide_us = get_average_microseconds([&]() {
+            wide_str.clear();
+            encode_wstring_reference(cells, wide_str);
+            }, iterations);
+
+         moo::FrameEncoder encoder;
+         encoder.m_delta_frames = false;
+         moo::ByteBuffer utf8_str(moo::get_max_frame_size());
+         const double utf8_us = get_average_microseconds([&]() {
+            utf8_str.clear();
+            encoder.encode(cells, utf8_str);
+            }, iterations);
+
+         printf(
+            "colors every %3i cells: wstring %8.1f us (%7zu bytes), utf8 %8.1f us (%7zu bytes)\n",
+            color_keep_period,
+            wide_us,
+            wide_str.size() * sizeof(wchar_t),
+            utf8_us,
+            utf8_str.size()
+         );
+      }
+   }
+
+
+   auto run_orientation_benchmark() -> void {
+      constexpr int iterations = 500;
+      printf("\nGlyph orientation planning, full frames\n");
+      for (const int color_keep_period : { 1, 4, 16, 120 }) {
+         const moo::CellBuffer cells = get_benchmark_cells(color_keep_period);
+         printf("colors every %3i cells:", color_keep_period);
+         for (const bool optimize : { false, true }) {
+            moo::FrameEncoder encoder;
+            encoder.m_delta_frames = false;
+            encoder.m_optimize_glyph_orientation = optimize;
+            moo::ByteBuffer str(moo::get_max_frame_size());
+            const double us = get_average_microseconds([&]() {
+               str.clear();
+               encoder.encode(cells, str);
+               }, iterations);
+            printf(
+               " %s %8.1f us (%5u color changes, %7zu bytes)",
+               optimize ? "planned" : "as is",
+               us,
+               encoder.get_paint_count(),
+               str.size()
+            );
+         }
+         printf("\n");
+      }
+   }
+
+
+   auto run_color_mode_benchmark() -> void {
+      constexpr int iterations = 500;
+      printf("\nColor modes, full frames\n");
+      for (const int color_keep_period : { 1, 4, 16, 120 }) {
+         const moo::CellBuffer cells = get_benchmark_cells(color_keep_period);
+         printf("colors every %3i cells:", color_keep_period);
+         for (const moo::ColorMode mode : { moo::ColorMode::TrueColor, moo::ColorMode::Palette256, moo::ColorMode::Palette16 }) {
+            // Like combine_buffers() does
+            moo::CellBuffer quantized_cells = cells;
+            for (moo::Cell& cell : quantized_cells.m_colors) {
+               cell.fg = moo::get_quantized_color(cell.fg, mode);
+               cell.bg = moo::get_quantized_color(cell.bg, mode);
+            }
+
+            moo::FrameEncoder encoder(mode);
+            encoder.m_delta_frames = false;
+            moo::ByteBuffer str(moo::get_max_frame_size());
+            const double us = get_average_microseconds([&]() {
+               str.clear();
+               encoder.encode(quantized_cells, str);
+               }, iterations);
+            printf(" %6.1f us (%4u changes, %6zu bytes)", us, encoder.get_paint_count(), str.size());
+         }
+         printf("\n");
+      }
+   }
+
+
+   // Half of the screen covered by rectangles of mostly one color, like sprites. The rest is transparent.
+   [[nodiscard]] auto get_benchmark_pixels() -> std::vector<moo::RGB> {
+      const int pixel_rows = 2 * moo::static_rows;
+      const int pixel_columns = 2 * moo::static_columns;
+      std::vector<moo::RGB> pixels(moo::get_pixel_count());
+      std::uniform_int_distribution<int> i_dist(0, pixel_rows - 1);
+      std::uniform_int_distribution<int> j_dist(0, pixel_columns - 1);
+      std::uniform_int_distribution<int> size_dist(2, 16);
+      std::uniform_int_distribution<int> noise_dist(0, 3);
+      size_t covered = 0;
+      while (covered < pixels.size() / 2) {
+         const moo::RGB color = get_random_color(1, 255);
+         const int top = i_dist(moo::get_rng());
+         const int left = j_dist(moo::get_rng());
+         const int bottom = std::min(top + size_dist(moo::get_rng()), pixel_rows);
+         const int right = std::min(left + size_dist(moo::get_rng()), pixel_columns);
+         for (int i = top; i < bottom; ++i) {
+            for (int j = left; j < right; ++j) {
+               moo::RGB& pixel = pixels[moo::to_screen_index(moo::PixelCoord{ i, j })];
+               if (pixel.is_invisible())
+                  ++covered;
+               pixel = (noise_dist(moo::get_rng()) == 0) ? get_random_color(1, 255) : color;
+            }
+         }
+      }
+      return pixels;
+   }
+
+
+   // Building the cells from the pixels like combine_buffers() does, and encoding them
+   auto run_cell_mode_benchmark() -> void {
+      constexpr int iterations = 500;
+      printf("\nCell modes, full frames with half of the pixels covered\n");
+      const std::vector<moo::RGB> pixels = get_benchmark_pixels();
+      const auto get_pixel = [&](const moo::PixelCoord& pos) {
+         return pixels[moo::to_screen_index(pos)];
+      };
+      constexpr moo::RGB bg_color{ 90, 140, 200 };
+      for (const auto& [mode, name] : { std::pair{ moo::CellMode::Quadrants, "quadrants:" }, std::pair{ moo::CellMode::HalfBlocks, "half blocks:" } }) {
+         moo::CellBuffer cells;
+         const double build_us = get_average_microseconds([&]() {
+            for (moo::LineCoordIt it = moo::get_screen_it(); it.is_valid(); ++it) {
+               const moo::PixelCoord tl = moo::to_pixel_coord_tl(*it);
+               moo::Cell& cell = cells[moo::to_screen_index(*it)];
+               if (mode == moo::CellMode::Quadrants) {
+                  const moo::BlockChar block_char{
+                     get_pixel(tl), get_pixel(tl + moo::PixelCoord{ 0, 1 }),
+                     get_pixel(tl + moo::PixelCoord{ 1, 0 }), get_pixel(tl + moo::PixelCoord{ 1, 1 })
+                  };
+                  cell = moo::get_quadrant_cell(block_char, bg_color);
+               }
+               else {
+                  const moo::HalfBlock half_block{
+                     moo::get_half_block_pixel(get_pixel(tl), get_pixel(tl + moo::PixelCoord{ 0, 1 })),
+                     moo::get_half_block_pixel(get_pixel(tl + moo::PixelCoord{ 1, 0 }), get_pixel(tl + moo::PixelCoord{ 1, 1 }))
+                  };
+                  cell = moo::get_half_block_cell(half_block, bg_color);
+               }
+            }
+            }, iterations);
+
+         moo::FrameEncoder encoder;
+         encoder.m_delta_frames = false;
+         moo::ByteBuffer str(moo::get_max_frame_size());
+         const double encode_us = get_average_microseconds([&]() {
+            str.clear();
+            encoder.encode(cells, str);
+            }, iterations);
+         printf(
+            "%-12s cells %6.1f us, encoding %6.1f us (%5u color changes, %7zu bytes)\n",
+            name,
+            build_us,
+            encode_us,
+            encoder.get_paint_count(),
+            str.size()
+         );
+      }
+   }
+
+
+   // The background fade of combine_buffers(), over the whole screen
+   auto run_blend_benchmark() -> void {
+      constexpr int iterations = 2000;
+      printf("\nBlending %zu cells to black\n", moo::get_char_count());
+      const moo::CellBuffer cells = get_benchmark_cells(1);
+      std::vector<moo::RGB> source(moo::get_char_count());
+      for (size_t i = 0; i < source.size(); ++i)
+         source[i] = cells[i].bg;
+      std::vector<moo::RGB> target(source.size());
+
+      const double double_us = get_average_microseconds([&]() {
+         for (size_t i = 0; i < source.size(); ++i)
+            target[i] = moo::get_color_mix(source[i], moo::RGB{ 0, 0, 0 }, 0.7);
+         }, iterations);
+      const double fixed_us = get_average_microseconds([&]() {
+         for (size_t i = 0; i < source.size(); ++i)
+            target[i] = moo::get_fixed_color_mix(source[i], moo::RGB{ 0, 0, 0 }, moo::get_blend_factor(0.7));
+         }, iterations);
+      const double span_us = get_average_microseconds([&]() {
+         moo::blend_to_color(source, moo::RGB{ 0, 0, 0 }, moo::get_blend_factor(0.7), target);
+         }, iterations);
+      printf("double: %.2f us, fixed-point: %.2f us, span kernel: %.2f us\n", double_us, fixed_us, span_us);
+   }
+
+
+   // A mountain range covers the lower half, with a random skyline
+   auto fill_mountain(moo::BgColorBuffer& mountain, const moo::RGB& color) -> void {
+      std::uniform_int_distribution<int> height_dist(moo::static_rows / 4, moo::static_rows / 2);
+      for (int j = 0; j < moo::static_columns; ++j) {
+         const int height = height_dist(moo::get_rng());
+         for (int i = moo::static_rows - height; i < moo::static_rows; ++i)
+            mountain[moo::to_screen_index(moo::LineCoord{ i, j })] = color;
+      }
+   }
+
+
+   // Like draw_to_bg() with a cloud: an ellipse of 40 x 8 cells
+   auto draw_cloud(moo::BgBuffer& target, const moo::LineCoord& top_left, const double alpha) -> void {
+      const unsigned char alpha_byte = moo::get_alpha(alpha);
+      for (int i = 0; i < 8; ++i) {
+         for (int j = 0; j < 40; ++j) {
+            const double x = (j - 19.5) / 20.0;
+            const double y = (i - 3.5) / 4.0;
+            const moo::LineCoord pos = top_left + moo::LineCoord{ i, j };
+            if (x * x + y * y > 1.0 || !moo::is_on_screen(pos))
+               continue;
+            const size_t index = moo::to_screen_index(pos);
+            target[index] = moo::get_accumulated(target[index], moo::RGB{ 240, 240, 245 }, alpha_byte);
+         }
+      }
+   }
+
+
+   // A layout with one plane per channel was tried against this. Its branchless passes vectorized, but
+   // only made the mountain pass faster (16 vs 20 us) and the cloud slower (15 vs 13 us), so the game kept
+   // the interleaved buffers.
+   auto run_layer_benchmark() -> void {
+      constexpr int iterations = 2000;
+      moo::BgColorBuffer mountain;
+      moo::BgColorBuffer next_mountain;
+      fill_mountain(mountain, moo::RGB{ 90, 100, 120 });
+      fill_mountain(next_mountain, moo::RGB{ 90, 100, 120 });
+      moo::BgColorBuffer bg;
+      moo::BgBuffer blending_buffer;
+
+      const double mountain_us = get_average_microseconds([&]() {
+         blending_buffer.clear();
+         moo::add_layer(next_mountain, blending_buffer, 0.3);
+         moo::add_layer(mountain, blending_buffer, 0.7);
+         moo::blend_buffer(blending_buffer, bg);
+         }, iterations);
+      const double cloud_us = get_average_microseconds([&]() {
+         blending_buffer.clear();
+         draw_cloud(blending_buffer, moo::LineCoord{ 3, 10 }, 0.3);
+         draw_cloud(blending_buffer, moo::LineCoord{ 3, 11 }, 0.7);
+         moo::blend_buffer(blending_buffer, bg);
+         }, iterations);
+      printf("mountain range: %6.2f us, cloud: %6.2f us\n", mountain_us, cloud_us);
+   }
+
+
+   /// <summary>Where the throughput benchmark writes its frames to. Pipes and ptys get drained by a thread,
+   /// like a terminal would read them.</summary>
+   struct FrameSink {
+      explicit FrameSink(const moo::ThroughputSink sink);
+      ~FrameSink();
+      FrameSink(const FrameSink& copy) = delete;
+      FrameSink& operator=(const FrameSink& copy) = delete;
+
+      auto write(const std::string_view bytes) -> void;
+
+   private:
+      std::optional<moo::Terminal> m_terminal;
+      std::FILE* m_file = nullptr;
+      std::filesystem::path m_file_path;
+      int m_write_fd = -1;
+      int m_read_fd = -1;
+      std::jthread m_drain_thread;
+   };
+
+
+   FrameSink::FrameSink(const moo::ThroughputSink sink) {
+      if (sink == moo::ThroughputSink::Console) {
+         m_terminal.emplace();
+         return;
+      }
+      if (sink == moo::ThroughputSink::File) {
+         m_file_path = std::filesystem::temp_directory_path() / "terminal_moo_frames.ans";
+         m_file = std::fopen(m_file_path.string().c_str(), "wb");
+         if (m_file == nullptr) {
+            printf("Couldn't open %s\n", m_file_path.string().c_str());
+            std::terminate();
+         }
+         return;
+      }
+#ifdef _WIN32
+      printf("Pipes and ptys are only available on POSIX systems\n");
+      std::terminate();
+#else
+      if (sink == moo::ThroughputSink::Pipe) {
+         int fds[2];
+         if (pipe(fds) != 0) {
+            printf("pipe() fail.\n");
+            std::terminate();
+         }
+         m_read_fd = fds[0];
+         m_write_fd = fds[1];
+      }
+      else {
+         // The program writes to the slave side, the terminal emulator would read the master side
+         m_read_fd = posix_openpt(O_RDWR | O_NOCTTY);
+         if (m_read_fd < 0 || grantpt(m_read_fd) != 0 || unlockpt(m_read_fd) != 0) {
+            printf("posix_openpt() fail.\n");
+            std::terminate();
+         }
+         const char* slave_name = ptsname(m_read_fd);
+         if (slave_name == nullptr) {
+            printf("ptsname() fail.\n");
+            std::terminate();
+         }
+         m_write_fd = open(slave_name, O_WRONLY | O_NOCTTY);
+         if (m_write_fd < 0) {
+            printf("open() fail.\n");
+            std::terminate();
+         }
+         termios raw;
+         tcgetattr(m_write_fd, &raw);
+         cfmakeraw(&raw);
+         tcsetattr(m_write_fd, TCSANOW, &raw);
+      }
+      m_drain_thread = std::jthread([read_fd = m_read_fd]() {
+         std::vector<char> buffer(1 << 16);
+         while (read(read_fd, buffer.data(), buffer.size()) > 0) {}
+         });
+#endif
+   }
+
+
+   FrameSink::~FrameSink() {
+      if (m_file != nullptr) {
+         std::fclose(m_file);
+         std::filesystem::remove(m_file_path);
+      }
+#ifndef _WIN32
+      // Closing the write side ends the reads of the drain thread
+      if (m_write_fd >= 0)
+         close(m_write_fd);
+      if (m_drain_thread.joinable())
+         m_drain_thread.join();
+      if (m_read_fd >= 0)
+         close(m_read_fd);
+#endif
+   }
+
+
+   auto FrameSink::write(const std::string_view bytes) -> void {
+      if (m_terminal.has_value()) {
+         m_terminal->write(bytes);
+         return;
+      }
+      if (m_file != nullptr) {
+         std::fwrite(bytes.data(), 1, bytes.size(), m_file);
+         std::fflush(m_file);
+         return;
+      }
+#ifndef _WIN32
+      size_t written = 0;
+      while (written < bytes.size()) {
+         const ssize_t result = ::write(m_write_fd, bytes.data() + written, bytes.size() - written);
+         if (result < 0 && errno != EINTR) {
+            printf("write() fail.\n");
+            std::terminate();
+         }
+         if (result > 0)
+            written += static_cast<size_t>(result);
+      }
+#endif
+   }
+
+
+   struct ThroughputResult {
+      const char* mode_name = "";
+      int rows = 0;
+      int columns = 0;
+      int color_keep_period = 0;
+      double color_changes = 0.0;
+      double encode_us = 0.0;
+      double write_us = 0.0;
+      double bytes = 0.0;
+   };
+
+
+   [[nodiscard]] auto get_fps(const ThroughputResult& result) -> double {
+      return 1'000'000.0 / (result.encode_us + result.write_us);
+   }
+
+
+   [[nodiscard]] auto measure_throughput(
+      const moo::ColorMode mode,
+      const int color_keep_period,
+      FrameSink& sink
+   ) -> ThroughputResult
+   {
+      constexpr int frame_count = 60;
+      constexpr int distinct_frames = 8;
+
+      // Frames are generated beforehand and cycled through. Quantized like combine_buffers() does
+      std::vector<moo::CellBuffer> frames;
+      for (int i = 0; i < distinct_frames; ++i) {
+         frames.push_back(get_benchmark_cells(color_keep_period));
+         for (moo::Cell& cell : frames.back().m_colors) {
+            cell.fg = moo::get_quantized_color(cell.fg, mode);
+            cell.bg = moo::get_quantized_color(cell.bg, mode);
+         }
+      }
+
+      moo::FrameEncoder encoder(mode);
+      encoder.m_delta_frames = false;
+      moo::ByteBuffer str(moo::get_max_frame_size());
+      ThroughputResult result{ "", moo::static_rows, moo::static_columns, color_keep_period };
+      for (int i = 0; i < frame_count; ++i) {
+         str.clear();
+         const auto encode_start = std::chrono::steady_clock::now();
+         encoder.encode(frames[i % distinct_frames], str);
+         const auto write_start = std::chrono::steady_clock::now();
+         sink.write(str.get_view());
+         const auto write_end = std::chrono::steady_clock::now();
+
+         result.encode_us += std::chrono::duration<double, std::micro>(write_start - encode_start).count();
+         result.write_us += std::chrono::duration<double, std::micro>(write_end - write_start).count();
+         result.bytes += static_cast<double>(str.size());
+         result.color_changes += encoder.get_paint_count();
+      }
+      result.encode_us /= frame_count;
+      result.write_us /= frame_count;
+      result.bytes /= frame_count;
+      result.color_changes /= frame_count;
+      return result;
+   }
+
+} // namespace {}
+
+
+auto moo::get_throughput_sink(const std::string_view name) -> ThroughputSink{
+   if (name == "console")
+      return ThroughputSink::Console;
+   if (name == "file")
+      return ThroughputSink::File;
+   if (name == "pipe")
+      return ThroughputSink::Pipe;
+   if (name == "pty")
+      return ThroughputSink::Pty;
+   printf("Unknown throughput sink: %s\n", std::string(name).c_str());
+   std::terminate();
+}
+
+
+/// <summary>The generalized early_test(): sweeps the color changes per frame, screen sizes and color modes.
+/// Next to the CSV, it writes a plot_data.txt for text/plot_fps_vs_colors.py (truecolor at the default size).</summary>
+auto moo::run_throughput_benchmark(
+   const ThroughputSink sink_type,
+   const std::filesystem::path& csv_path
+) -> void
+{
+   constexpr std::array<TerminalSize, 3> screen_sizes{ { {24, 80}, {30, 120}, {60, 240} } };
+   constexpr std::array<int, 7> color_keep_periods{ 1, 2, 4, 8, 16, 32, 120 };
+   constexpr std::array<std::pair<ColorMode, const char*>, 3> modes{ {
+      { ColorMode::TrueColor, "truecolor" },
+      { ColorMode::Palette256, "256" },
+      { ColorMode::Palette16, "16" }
+   } };
+   const TerminalSize initial_size{ static_rows, static_columns };
+
+   std::vector<ThroughputResult> results;
+   {
+      FrameSink sink(sink_type);
+      for (const TerminalSize& size : screen_sizes) {
+         update_screen_size(size.rows, size.columns);
+         for (const auto& [mode, mode_name] : modes) {
+            for (const int color_keep_period : color_keep_periods) {
+               results.push_back(measure_throughput(mode, color_keep_period, sink));
+               results.back().mode_name = mode_name;
+            }
+         }
+      }
+   }
+   update_screen_size(initial_size.rows, initial_size.columns);
+
+   std::ofstream csv(csv_path);
+   csv << "mode,rows,columns,color_keep_period,color_changes,encode_us,write_us,bytes_per_frame,fps\n";
+   for (const ThroughputResult& result : results) {
+      csv << fmt::format(
+         "{},{},{},{},{:.1f},{:.1f},{:.1f},{:.0f},{:.1f}\n",
+         result.mode_name, result.rows, result.columns, result.color_keep_period, result.color_changes,
+         result.encode_us, result.write_us, result.bytes, get_fps(result)
+      );
+   }
+
+   std::ofstream plot_data(csv_path.parent_path() / "plot_data.txt");
+   for (const ThroughputResult& result : results) {
+      const bool is_plot_row = result.rows == 30 && result.columns == 120 && std::string_view(result.mode_name) == "truecolor";
+      if (is_plot_row)
+         plot_data << fmt::format("{:.0f} {:.1f}\n", result.color_changes, get_fps(result));
+   }
+   printf("%zu configurations written to %s\n", results.size(), csv_path.string().c_str());
+}
+
+
+auto moo::run_benchmarks() -> void{
+   run_encoding_benchmark();
+   run_orientation_benchmark();
+   run_color_mode_benchmark();
+   run_cell_mode_benchmark();
+   run_blend_benchmark();
+   printf("\nBackground layers, %i x %i cells\n", static_columns, static_rows);
+   run_layer_benchmark();
+}
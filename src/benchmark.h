@@ -0,0 +1,16 @@
+#pragma once
+
+#include <filesystem>
+#include <string_view>
+
+namespace moo {
+
+   enum class ThroughputSink { Console, File, Pipe, Pty };
+
+   /// <summary>Microbenchmarks of the hot paths, started with --benchmark. Results go to stdout.</summary>
+   auto run_benchmarks() -> void;
+
+   [[nodiscard]] auto get_throughput_sink(const std::string_view name) -> ThroughputSink;
+   auto run_throughput_benchmark(const ThroughputSink sink, const std::filesystem::path& csv_path) -> void;
+
+}
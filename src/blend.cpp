@@ -0,0 +1,211 @@
+#include "blend.h"
+
+#include <array>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#endif
+
+#include <doctest/doctest.h>
+#include <Tracy.hpp>
+
+
+static_assert(sizeof(moo::RGB) == 3, "The kernels treat spans of RGB as plain bytes");
+
+
+namespace {
+
+   // The color repeats every three bytes, vectors are 16 or 32 bytes. After lcm(3, vector size) bytes, the
+   // pattern of color bytes in the vectors repeats
+   constexpr int pattern_vectors = 3;
+
+
+   auto blend_to_color_scalar(
+      const unsigned char* source,
+      const moo::RGB& color,
+      const int factor,
+      unsigned char* target,
+      const size_t byte_count,
+      const size_t first_byte
+   ) -> void
+   {
+      const std::array<unsigned char, 3> color_bytes{ color.r, color.g, color.b };
+      for (size_t i = 0; i < byte_count; ++i)
+         target[i] = moo::get_fixed_mix(source[i], color_bytes[(first_byte + i) % 3], factor);
+   }
+
+
+#if defined(__AVX2__)
+   constexpr size_t vector_size = 32;
+
+   // Returns how many bytes were done
+   auto blend_to_color_vectorized(
+      const unsigned char* source,
+      const moo::RGB& color,
+      const int factor,
+      unsigned char* target,
+      const size_t byte_count
+   ) -> size_t
+   {
+      alignas(vector_size) std::array<unsigned char, pattern_vectors * vector_size> pattern;
+      for (size_t i = 0; i < pattern.size(); ++i)
+         pattern[i] = (i % 3 == 0) ? color.r : (i % 3 == 1) ? color.g : color.b;
+
+      // color * factor + rounding, unpacked like the source bytes get unpacked
+      const __m256i zero = _mm256_setzero_si256();
+      const __m256i color_factor = _mm256_set1_epi16(static_cast<short>(factor));
+      const __m256i rounding = _mm256_set1_epi16(128);
+      __m256i color_terms_lo[pattern_vectors];
+      __m256i color_terms_hi[pattern_vectors];
+      for (int k = 0; k < pattern_vectors; ++k) {
+         const __m256i bytes = _mm256_load_si256(reinterpret_cast<const __m256i*>(pattern.data() + k * vector_size));
+         color_terms_lo[k] = _mm256_add_epi16(_mm256_mullo_epi16(_mm256_unpacklo_epi8(bytes, zero), color_factor), rounding);
+         color_terms_hi[k] = _mm256_add_epi16(_mm256_mullo_epi16(_mm256_unpackhi_epi8(bytes, zero), color_factor), rounding);
+      }
+
+      const __m256i source_factor = _mm256_set1_epi16(static_cast<short>(moo::blend_factor_one - factor));
+      size_t done = 0;
+      int k = 0;
+      for (; done + vector_size <= byte_count; done += vector_size) {
+         const __m256i bytes = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(source + done));
+         const __m256i lo = _mm256_add_epi16(_mm256_mullo_epi16(_mm256_unpacklo_epi8(bytes, zero), source_factor), color_terms_lo[k]);
+         const __m256i hi = _mm256_add_epi16(_mm256_mullo_epi16(_mm256_unpackhi_epi8(bytes, zero), source_factor), color_terms_hi[k]);
+         const __m256i result = _mm256_packus_epi16(_mm256_srli_epi16(lo, 8), _mm256_srli_epi16(hi, 8));
+         _mm256_storeu_si256(reinterpret_cast<__m256i*>(target + done), result);
+         k = (k + 1) % pattern_vectors;
+      }
+      return done;
+   }
+#elif defined(__SSE2__) || defined(_M_X64)
+   constexpr size_t vector_size = 16;
+
+   // Returns how many bytes were done
+   auto blend_to_color_vectorized(
+      const unsigned char* source,
+      const moo::RGB& color,
+      const int factor,
+      unsigned char* target,
+      const size_t byte_count
+   ) -> size_t
+   {
+      alignas(vector_size) std::array<unsigned char, pattern_vectors * vector_size> pattern;
+      for (size_t i = 0; i < pattern.size(); ++i)
+         pattern[i] = (i % 3 == 0) ? color.r : (i % 3 == 1) ? color.g : color.b;
+
+      // color * factor + rounding, unpacked like the source bytes get unpacked
+      const __m128i zero = _mm_setzero_si128();
+      const __m128i color_factor = _mm_set1_epi16(static_cast<short>(factor));
+      const __m128i rounding = _mm_set1_epi16(128);
+      __m128i color_terms_lo[pattern_vectors];
+      __m128i color_terms_hi[pattern_vectors];
+      for (int k = 0; k < pattern_vectors; ++k) {
+         const __m128i bytes = _mm_load_si128(reinterpret_cast<const __m128i*>(pattern.data() + k * vector_size));
+         color_terms_lo[k] = _mm_add_epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(bytes, zero), color_factor), rounding);
+         color_terms_hi[k] = _mm_add_epi16(_mm_mullo_epi16(_mm_unpackhi_epi8(bytes, zero), color_factor), rounding);
+      }
+
+      const __m128i source_factor = _mm_set1_epi16(static_cast<short>(moo::blend_factor_one - factor));
+      size_t done = 0;
+      int k = 0;
+      for (; done + vector_size <= byte_count; done += vector_size) {
+         const __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + done));
+         const __m128i lo = _mm_add_epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(bytes, zero), source_factor), color_terms_lo[k]);
+         const __m128i hi = _mm_add_epi16(_mm_mullo_epi16(_mm_unpackhi_epi8(bytes, zero), source_factor), color_terms_hi[k]);
+         const __m128i result = _mm_packus_epi16(_mm_srli_epi16(lo, 8), _mm_srli_epi16(hi, 8));
+         _mm_storeu_si128(reinterpret_cast<__m128i*>(target + done), result);
+         k = (k + 1) % pattern_vectors;
+      }
+      return done;
+   }
+#else
+   auto blend_to_color_vectorized(
+      const unsigned char*,
+      const moo::RGB&,
+      const int,
+      unsigned char*,
+      const size_t
+   ) -> size_t
+   {
+      return 0;
+   }
+#endif
+
+} // namespace {}
+
+
+auto moo::blend_to_color(
+   const std::span<const RGB> source,
+   const RGB& color,
+   const int factor,
+   const std::span<RGB> target
+) -> void
+{
+   ZoneScoped;
+   const size_t byte_count = 3 * std::min(source.size(), target.size());
+   const unsigned char* source_bytes = reinterpret_cast<const unsigned char*>(source.data());
+   unsigned char* target_bytes = reinterpret_cast<unsigned char*>(target.data());
+   const size_t done = blend_to_color_vectorized(source_bytes, color, factor, target_bytes, byte_count);
+   blend_to_color_scalar(source_bytes + done, color, factor, target_bytes + done, byte_count - done, done);
+}
+
+
+TEST_CASE("get_blended()") {
+   using namespace moo;
+   // All alphas and channel values, one channel at a time. A wrap-around would show as a large difference.
+   int max_difference = 0;
+   for (int alpha = 0; alpha < 256; ++alpha) {
+      const int factor = get_alpha_factor(static_cast<unsigned char>(alpha));
+      for (int t = 0; t < 256; ++t) {
+         for (int c = 0; c < 256; ++c) {
+            const RGB target{ static_cast<unsigned char>(t), 0, 0 };
+            const RGBA cell = get_accumulated(RGBA{}, RGB{ static_cast<unsigned char>(c), 0, 0 }, static_cast<unsigned char>(alpha));
+            const int blended = get_blended(target, cell).r;
+            const int expected = get_fixed_mix(target.r, static_cast<unsigned char>(c), factor);
+            max_difference = std::max(max_difference, std::abs(blended - expected));
+         }
+      }
+   }
+   CHECK(max_difference <= 1);
+
+   // The alphas of a layer and its shifted version add up to an opaque color
+   const RGBA half = get_accumulated(RGBA{}, RGB{ 10, 20, 30 }, get_alpha(0.25));
+   const RGBA full = get_accumulated(half, RGB{ 40, 50, 60 }, get_alpha(0.75));
+   CHECK(get_blended(RGB{ 200, 200, 200 }, full) == RGB{ 40, 50, 60 });
+}
+
+
+TEST_CASE("blend_to_color()") {
+   using namespace moo;
+   std::mt19937 rng(1);
+   const auto get_random_color = [&]() {
+      return RGB{ static_cast<unsigned char>(rng()), static_cast<unsigned char>(rng()), static_cast<unsigned char>(rng()) };
+   };
+
+   // All lengths around the vector sizes, and the extreme factors
+   for (size_t size = 0; size < 100; ++size) {
+      for (const int factor : { 0, 1, 77, 128, 255, blend_factor_one }) {
+         std::vector<RGB> source(size);
+         for (RGB& color : source)
+            color = get_random_color();
+         const RGB color = get_random_color();
+
+         std::vector<RGB> target(size);
+         blend_to_color(source, color, factor, target);
+         size_t mismatches = 0;
+         for (size_t i = 0; i < size; ++i) {
+            if (target[i] != get_fixed_color_mix(source[i], color, factor))
+               ++mismatches;
+         }
+         CHECK(mismatches == 0);
+
+         // In place
+         blend_to_color(source, color, factor, source);
+         CHECK(source == target);
+      }
+   }
+}
@@ -0,0 +1,120 @@
+#pragma once
+
+#include "color.h"
+
+#include <algorithm>
+#include <span>
+
+
+namespace moo {
+
+   // Blend factors are fixed-point with 8 fractional bits: 0 keeps the first color, 256 is the second one
+   constexpr int blend_factor_one = 256;
+
+   [[nodiscard]] constexpr auto get_blend_factor(const double factor) -> int;
+   [[nodiscard]] constexpr auto get_fixed_mix(const unsigned char a, const unsigned char b, const int factor) -> unsigned char;
+   [[nodiscard]] constexpr auto get_fixed_color_mix(const RGB& a, const RGB& b, const int factor) -> RGB;
+
+   // Premultiplied 8-bit alpha
+   [[nodiscard]] constexpr auto get_alpha(const double alpha) -> unsigned char;
+   [[nodiscard]] constexpr auto get_alpha_factor(const unsigned char alpha) -> int;
+   [[nodiscard]] constexpr auto get_premultiplied(const unsigned char c, const int factor) -> unsigned char;
+   [[nodiscard]] constexpr auto get_accumulated(const RGBA& cell, const RGB& color, const unsigned char alpha) -> RGBA;
+   [[nodiscard]] constexpr auto get_blended(const RGB& target, const RGBA& cell) -> RGB;
+
+   /// <summary>target = mix(source, color, factor) for whole spans, with SSE2 or AVX2 where the build has
+   /// them. Gives exactly the results of get_fixed_color_mix(). Source and target may be the same.</summary>
+   auto blend_to_color(std::span<const RGB> source, const RGB& color, const int factor, std::span<RGB> target) -> void;
+
+}
+
+
+constexpr auto moo::get_blend_factor(const double factor) -> int{
+   return std::clamp(static_cast<int>(factor * blend_factor_one + 0.5), 0, blend_factor_one);
+}
+
+
+// Both products fit into 16 bits, which is what the vectorized versions rely on
+constexpr auto moo::get_fixed_mix(
+   const unsigned char a,
+   const unsigned char b,
+   const int factor
+) -> unsigned char
+{
+   return static_cast<unsigned char>((a * (blend_factor_one - factor) + b * factor + 128) >> 8);
+}
+static_assert(moo::get_fixed_mix(10, 200, 0) == 10);
+static_assert(moo::get_fixed_mix(10, 200, moo::blend_factor_one) == 200);
+static_assert(moo::get_fixed_mix(0, 255, moo::get_blend_factor(0.5)) == 128);
+
+
+constexpr auto moo::get_fixed_color_mix(
+   const RGB& a,
+   const RGB& b,
+   const int factor
+) -> RGB
+{
+   return {
+      get_fixed_mix(a.r, b.r, factor),
+      get_fixed_mix(a.g, b.g, factor),
+      get_fixed_mix(a.b, b.b, factor)
+   };
+}
+
+
+// Rounded, so that get_alpha(x) + get_alpha(1 - x) is at least 255 and two shifted layers add up to full
+// opacity
+constexpr auto moo::get_alpha(const double alpha) -> unsigned char{
+   return static_cast<unsigned char>(std::clamp(static_cast<int>(alpha * 255.0 + 0.5), 0, 255));
+}
+static_assert(moo::get_alpha(0.3) + moo::get_alpha(0.7) >= 255);
+static_assert(moo::get_alpha(0.25) + moo::get_alpha(0.75) >= 255);
+
+
+// Maps 0..255 to the blend factors 0..256. Never gives 128, which get_blended() relies on.
+constexpr auto moo::get_alpha_factor(const unsigned char alpha) -> int{
+   return alpha + (alpha >> 7);
+}
+static_assert(moo::get_alpha_factor(0) == 0);
+static_assert(moo::get_alpha_factor(255) == moo::blend_factor_one);
+
+
+constexpr auto moo::get_premultiplied(const unsigned char c, const int factor) -> unsigned char{
+   return static_cast<unsigned char>((c * factor + 128) >> 8);
+}
+
+
+// The color replaces the one in the cell, but the alphas add up (saturated)
+constexpr auto moo::get_accumulated(
+   const RGBA& cell,
+   const RGB& color,
+   const unsigned char alpha
+) -> RGBA
+{
+   const unsigned char sum = static_cast<unsigned char>(std::min(cell.m_alpha + alpha, 255));
+   const int factor = get_alpha_factor(sum);
+   return {
+      RGB{ get_premultiplied(color.r, factor), get_premultiplied(color.g, factor), get_premultiplied(color.b, factor) },
+      sum
+   };
+}
+
+
+// Within 1 of get_fixed_color_mix() with the same factor. The two rounded products only add up to 256 for
+// two 255s and a factor of 128.
+constexpr auto moo::get_blended(
+   const RGB& target,
+   const RGBA& cell
+) -> RGB
+{
+   const int factor = get_alpha_factor(cell.m_alpha);
+   return {
+      static_cast<unsigned char>(get_premultiplied(target.r, blend_factor_one - factor) + cell.m_rgb.r),
+      static_cast<unsigned char>(get_premultiplied(target.g, blend_factor_one - factor) + cell.m_rgb.g),
+      static_cast<unsigned char>(get_premultiplied(target.b, blend_factor_one - factor) + cell.m_rgb.b)
+   };
+}
+static_assert(moo::get_blended(moo::RGB{ 255, 0, 10 }, moo::get_accumulated(moo::RGBA{}, moo::RGB{ 255, 255, 10 }, 128)) == moo::RGB{ 255, 128, 10 });
+static_assert(moo::get_blended(moo::RGB{ 1, 2, 3 }, moo::get_accumulated(moo::RGBA{}, moo::RGB{ 4, 5, 6 }, 255)) == moo::RGB{ 4, 5, 6 });
+static_assert(moo::get_blended(moo::RGB{ 1, 2, 3 }, moo::RGBA{}) == moo::RGB{ 1, 2, 3 });
+static_assert(sizeof(moo::RGBA) == 4);
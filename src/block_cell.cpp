@@ -0,0 +1,144 @@
+﻿#include "block_cell.h"
+
+#include <cstdio>
+#include <exception>
+#include <string>
+
+#include <doctest/doctest.h>
+
+
+namespace {
+
+   struct CharAndColor {
+      wchar_t ch = '\0';
+      moo::RGB color;
+   };
+   
+
+   template<typename T>
+   constexpr wchar_t get_block_glyph(
+      const moo::BlockChar& block_char,
+      const T& pred
+   ) {
+      const bool tl = pred(block_char.top_left);
+      const bool tr = pred(block_char.top_right);
+      const bool bl = pred(block_char.bottom_left);
+      const bool br = pred(block_char.bottom_right);
+
+      if (!tl && !tr && !bl && !br)
+         return L' ';
+      else if (tl && tr && bl && br)
+         return L'█';
+
+      else if (!tl && !tr && !bl && br)
+         return L'▗';
+      else if (!tl && !tr && bl && !br)
+         return L'▖';
+      else if (!tl && tr && !bl && !br)
+         return L'▝';
+      else if (tl && !tr && !bl && !br)
+         return L'▘';
+
+      else if (tl && !tr && !bl && br)
+         return L'▚';
+      else if (!tl && tr && bl && !br)
+         return L'▞';
+
+      else if (tl && tr && !bl && !br)
+         return L'▀';
+      else if (!tl && !tr && bl && br)
+         return L'▄';
+      else if (tl && !tr && bl && !br)
+         return L'▌';
+      else if (!tl && tr && !bl && br)
+         return L'▐';
+
+      else if (tl && tr && bl && !br)
+         return L'▛';
+      else if (tl && tr && !bl && br)
+         return L'▜';
+      else if (tl && !tr && bl && br)
+         return L'▙';
+      else if (!tl && tr && bl && br)
+         return L'▟';
+
+      printf("This shouldn't happen\n");
+      std::terminate();
+   }
+   static_assert(get_block_glyph({ {1, 0, 0}, {1, 0, 0}, {0, 0, 0}, {0, 0, 0} }, moo::is_color_visible) == L'▀');
+
+
+   constexpr CharAndColor get_cell_char(
+      const moo::BlockChar& block_char
+   ) {
+      if (block_char.is_all_invisible())
+         return { ' ', moo::RGB{} };
+
+      CharAndColor ret;
+      ret.ch = get_block_glyph(block_char, moo::is_color_visible);
+      ret.color = block_char.get_best_color();
+
+      return ret;
+   }
+
+} // namespace {}
+
+
+auto moo::get_cell_mode(const std::string_view name) -> CellMode{
+   if (name == "quadrants")
+      return CellMode::Quadrants;
+   if (name == "half_blocks")
+      return CellMode::HalfBlocks;
+   printf("Unknown cell mode: %s\n", std::string(name).c_str());
+   std::terminate();
+}
+
+
+auto moo::get_quadrant_cell(
+   const BlockChar& block_char,
+   const RGB& bg_color
+) -> Cell
+{
+   const std::optional<TwoColors> two_colors = block_char.get_two_colors();
+   if (block_char.is_all_visible() && two_colors.has_value()) {
+      // no BG visible and FG contains 2+ different colors. Can use two FG colors in this cell!
+      const wchar_t block_char_char = get_block_glyph(block_char, [&](const RGB& color) {return color == two_colors.value().first; });
+      return { block_char_char, two_colors.value().first, two_colors.value().second };
+   }
+   const CharAndColor char_and_col = get_cell_char(block_char);
+   return { char_and_col.ch, char_and_col.color, bg_color };
+}
+
+
+// Two pixels always fit into the two colors of a cell
+auto moo::get_half_block_cell(
+   const HalfBlock& half_block,
+   const RGB& bg_color
+) -> Cell
+{
+   const bool top_visible = half_block.top.is_visible();
+   const bool bottom_visible = half_block.bottom.is_visible();
+   if (top_visible && bottom_visible) {
+      if (half_block.top == half_block.bottom)
+         return { L'█', half_block.top, bg_color };
+      return { L'▀', half_block.top, half_block.bottom };
+   }
+   if (top_visible)
+      return { L'▀', half_block.top, bg_color };
+   if (bottom_visible)
+      return { L'▄', half_block.bottom, bg_color };
+   return { L' ', RGB{}, bg_color };
+}
+
+
+TEST_CASE("get_half_block_cell()") {
+   using namespace moo;
+   constexpr RGB bg{ 10, 20, 30 };
+   constexpr RGB x{ 1, 2, 3 };
+   constexpr RGB y{ 4, 5, 6 };
+   CHECK(get_half_block_cell({ RGB{}, RGB{} }, bg) == Cell{ L' ', RGB{}, bg });
+   CHECK(get_half_block_cell({ x, RGB{} }, bg) == Cell{ L'▀', x, bg });
+   CHECK(get_half_block_cell({ RGB{}, x }, bg) == Cell{ L'▄', x, bg });
+   CHECK(get_half_block_cell({ x, x }, bg) == Cell{ L'█', x, bg });
+   CHECK(get_half_block_cell({ x, y }, bg) == Cell{ L'▀', x, y });
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include "block_char.h"
+#include "cell.h"
+#include "color.h"
+
+#include <string_view>
+
+
+namespace moo {
+
+   /// <summary>How the pixels become cells. Quadrants draw 2x2 pixels per cell with the quadrant glyphs,
+   /// which needs up to four colors per cell to be reduced to two. Half blocks draw 1x2 pixels per cell with
+   /// only the upper and lower half block, which is always exact and reads half the pixels.</summary>
+   enum class CellMode { Quadrants, HalfBlocks };
+
+   [[nodiscard]] auto get_cell_mode(const std::string_view name) -> CellMode;
+
+   // The two pixels of a cell in the half block mode
+   struct HalfBlock {
+      RGB top;
+      RGB bottom;
+   };
+
+   // The left pixel, unless only the right one is visible. That keeps one pixel wide things visible.
+   [[nodiscard]] constexpr auto get_half_block_pixel(const RGB& left, const RGB& right) -> RGB;
+
+   [[nodiscard]] auto get_quadrant_cell(const BlockChar& block_char, const RGB& bg_color) -> Cell;
+   [[nodiscard]] auto get_half_block_cell(const HalfBlock& half_block, const RGB& bg_color) -> Cell;
+
+}
+
+
+constexpr auto moo::get_half_block_pixel(
+   const RGB& left,
+   const RGB& right
+) -> RGB
+{
+   return left.is_visible() ? left : right;
+}
+static_assert(moo::get_half_block_pixel(moo::RGB{}, moo::RGB{ 1, 2, 3 }) == moo::RGB{ 1, 2, 3 });
+static_assert(moo::get_half_block_pixel(moo::RGB{ 4, 5, 6 }, moo::RGB{ 1, 2, 3 }) == moo::RGB{ 4, 5, 6 });
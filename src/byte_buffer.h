@@ -0,0 +1,68 @@
+#pragma once
+
+#include <array>
+#include <cstring>
+#include <string_view>
+#include <vector>
+
+namespace moo {
+
+   /// <summary>Preallocated output bytes. Appending never allocates and doesn't check the size, so the
+   /// capacity has to be enough for a whole frame (see get_max_frame_size()).</summary>
+   struct ByteBuffer {
+      explicit ByteBuffer(const size_t capacity)
+         : m_bytes(capacity + max_padding, '\0')
+      {
+
+      }
+
+      auto clear() -> void {
+         m_size = 0;
+      }
+
+      auto truncate(const size_t size) -> void {
+         m_size = size;
+      }
+
+      auto operator+=(const char c) -> ByteBuffer& {
+         m_bytes[m_size++] = c;
+         return *this;
+      }
+
+      auto operator+=(const std::string_view str) -> ByteBuffer& {
+         append(str.data(), str.size());
+         return *this;
+      }
+
+      auto append(const char* data, const size_t length) -> void {
+         std::memcpy(m_bytes.data() + m_size, data, length);
+         m_size += length;
+      }
+
+      // Copies all n bytes but only keeps length of them. A fixed size copy is a lot cheaper than a variable one
+      template<size_t n>
+      auto append_padded(const std::array<char, n>& data, const size_t length) -> void {
+         static_assert(n <= max_padding);
+         std::memcpy(m_bytes.data() + m_size, data.data(), n);
+         m_size += length;
+      }
+
+      [[nodiscard]] auto size() const -> size_t {
+         return m_size;
+      }
+
+      [[nodiscard]] auto empty() const -> bool {
+         return m_size == 0;
+      }
+
+      [[nodiscard]] auto get_view() const -> std::string_view {
+         return { m_bytes.data(), m_size };
+      }
+
+   private:
+      static constexpr size_t max_padding = 8;
+      std::vector<char> m_bytes;
+      size_t m_size = 0;
+   };
+
+}
@@ -0,0 +1,432 @@
+#include "calibration.h"
+
+#include "cc.h"
+#include "cell.h"
+#include "frame_encoder.h"
+#include "painter.h"
+#include "rng.h"
+#include "screen_size.h"
+#include "terminal.h"
+
+#include <array>
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <limits>
+#include <optional>
+#include <random>
+#include <string>
+
+#include <doctest/doctest.h>
+#include <fmt\format.h>
+#include <toml++/toml.h>
+
+
+namespace {
+
+   constexpr const char* cache_path = "calibration.toml";
+   constexpr int probe_repetitions = 10;
+
+   // Palette modes are only chosen if true colors can't keep up with this
+   constexpr double frame_budget_us = 1'000'000.0 / 60.0;
+
+
+   [[nodiscard]] auto get_variable(const char* name) -> std::string {
+      const char* value = std::getenv(name);
+      return value == nullptr ? std::string() : std::string(value);
+   }
+
+
+   // Costs are cached per terminal. Emulators that set a variable of their own are told apart by it, along
+   // with their version where the variable holds one. Window and session ids are unique, so only their
+   // presence counts. Everything else is only known by TERM, which many emulators share: those share one
+   // cache entry, and --calibrate measures again after switching between them.
+   [[nodiscard]] auto get_terminal_name() -> std::string {
+      if (std::getenv("WT_SESSION") != nullptr)
+         return "Windows Terminal";
+      if (const std::string program = get_variable("TERM_PROGRAM"); !program.empty())
+         return fmt::format("{} {}", program, get_variable("TERM_PROGRAM_VERSION"));
+      for (const auto& [variable, name] : { std::pair{ "KONSOLE_VERSION", "Konsole" }, std::pair{ "VTE_VERSION", "VTE" } }) {
+         if (const std::string version = get_variable(variable); !version.empty())
+            return fmt::format("{} {}", name, version);
+      }
+      for (const auto& [variable, name] : { std::pair{ "KITTY_WINDOW_ID", "kitty" }, std::pair{ "ALACRITTY_WINDOW_ID", "Alacritty" } }) {
+         if (std::getenv(variable) != nullptr)
+            return name;
+      }
+      if (const std::string term = get_variable("TERM"); !term.empty())
+         return term;
+      return "console";
+   }
+
+
+   [[nodiscard]] auto read_cached_costs(const std::string& terminal_name) -> std::optional<moo::TerminalCosts> {
+      if (!std::filesystem::exists(cache_path))
+         return std::nullopt;
+      toml::table tbl;
+      try {
+         tbl = toml::parse_file(cache_path);
+      }
+      catch (const toml::parse_error&) {
+         return std::nullopt;
+      }
+      if (tbl["terminal"].value_or(std::string()) != terminal_name)
+         return std::nullopt;
+      return moo::TerminalCosts{
+         tbl["byte_us"].value_or(0.0),
+         tbl["color_change_us"].value_or(0.0),
+         tbl["cursor_move_us"].value_or(0.0),
+         tbl["supports_repeat"].value_or(false)
+      };
+   }
+
+
+   auto write_cached_costs(
+      const std::string& terminal_name,
+      const moo::TerminalCosts& costs
+   ) -> void
+   {
+      std::ofstream file(cache_path);
+      file << fmt::format("terminal = \"{}\"\n", terminal_name);
+      file << fmt::format("byte_us = {}\n", costs.byte_us);
+      file << fmt::format("color_change_us = {}\n", costs.color_change_us);
+      file << fmt::format("cursor_move_us = {}\n", costs.cursor_move_us);
+      file << fmt::format("supports_repeat = {}\n", costs.supports_repeat);
+   }
+
+
+   [[nodiscard]] auto get_random_color() -> moo::RGB {
+      std::uniform_int_distribution<int> channel_dist(0, 255);
+      return {
+         static_cast<unsigned char>(channel_dist(moo::get_rng())),
+         static_cast<unsigned char>(channel_dist(moo::get_rng())),
+         static_cast<unsigned char>(channel_dist(moo::get_rng()))
+      };
+   }
+
+
+   auto append_cursor_position(const moo::LineCoord& pos, moo::ByteBuffer& target) -> void {
+      target += "\x1b[";
+      moo::append_decimal(pos.i + 1, target);
+      target += ';';
+      moo::append_decimal(pos.j + 1, target);
+      target += 'H';
+   }
+
+
+   // A screen of text without any color change
+   [[nodiscard]] auto get_text_probe(moo::ByteBuffer& target) -> moo::FrameStats {
+      target += "\x1b[H";
+      for (size_t index = 0; index < moo::get_char_count(); ++index)
+         target += 'x';
+      return { static_cast<double>(target.size()), 0.0, 1.0 };
+   }
+
+
+   // A new background color for every cell
+   [[nodiscard]] auto get_color_probe(moo::ByteBuffer& target) -> moo::FrameStats {
+      target += "\x1b[H";
+      moo::Painter painter;
+      for (size_t index = 0; index < moo::get_char_count(); ++index) {
+         painter.paint_layer(get_random_color(), moo::Layer::Back, target);
+         target += ' ';
+      }
+      target += "\x1b[0m";
+      return { static_cast<double>(target.size()), static_cast<double>(painter.get_paint_count()), 1.0 };
+   }
+
+
+   // Every other cell, each with a jump
+   [[nodiscard]] auto get_move_probe(moo::ByteBuffer& target) -> moo::FrameStats {
+      double moves = 0.0;
+      for (moo::LineCoordIt it = moo::get_screen_it(); it.is_valid(); ++it) {
+         if ((it->i + it->j) % 2 != 0)
+            continue;
+         append_cursor_position(*it, target);
+         target += 'x';
+         ++moves;
+      }
+      return { static_cast<double>(target.size()), 0.0, moves };
+   }
+
+
+   // How long a cursor position query takes on its own. It ends every timed batch, so this is taken off
+   // again
+   [[nodiscard]] auto get_round_trip_us(moo::Terminal& terminal) -> std::optional<double> {
+      const auto start = std::chrono::steady_clock::now();
+      for (int i = 0; i < probe_repetitions; ++i) {
+         if (!terminal.get_cursor_position().has_value())
+            return std::nullopt;
+      }
+      const std::chrono::duration<double, std::micro> duration = std::chrono::steady_clock::now() - start;
+      return duration.count() / probe_repetitions;
+   }
+
+
+   // write() can return as soon as the bytes are buffered (in the pty on POSIX), so the batch only counts
+   // as done once the terminal answers the cursor position query behind it
+   [[nodiscard]] auto run_probe(
+      moo::Terminal& terminal,
+      auto get_probe,
+      const double round_trip_us
+   ) -> std::optional<moo::Probe>
+   {
+      moo::ByteBuffer probe_str(moo::get_max_frame_size());
+      moo::Probe probe;
+      probe.stats = get_probe(probe_str);
+
+      // The first write is a warmup
+      terminal.write(probe_str.get_view());
+      if (!terminal.get_cursor_position().has_value())
+         return std::nullopt;
+      const auto start = std::chrono::steady_clock::now();
+      for (int i = 0; i < probe_repetitions; ++i)
+         terminal.write(probe_str.get_view());
+      if (!terminal.get_cursor_position().has_value())
+         return std::nullopt;
+      const std::chrono::duration<double, std::micro> duration = std::chrono::steady_clock::now() - start;
+      probe.microseconds = std::max(duration.count() - round_trip_us, 0.0) / probe_repetitions;
+      return probe;
+   }
+
+
+   // Windows 10 conhost and others ignore REP. A cell repeated twice only leaves the cursor three columns
+   // further if it worked
+   [[nodiscard]] auto get_repeat_support(moo::Terminal& terminal) -> std::optional<bool> {
+      terminal.write("\x1b[Hx\x1b[2b");
+      const std::optional<moo::LineCoord> position = terminal.get_cursor_position();
+      if (!position.has_value())
+         return std::nullopt;
+      return position->j == 3;
+   }
+
+
+   // Empty if the terminal doesn't answer cursor position queries, without those it can't be timed
+   [[nodiscard]] auto measure_costs() -> std::optional<moo::TerminalCosts> {
+      moo::Terminal terminal;
+      const std::optional<double> round_trip_us = get_round_trip_us(terminal);
+      if (!round_trip_us.has_value())
+         return std::nullopt;
+      const std::optional<moo::Probe> text = run_probe(terminal, get_text_probe, round_trip_us.value());
+      const std::optional<moo::Probe> colors = run_probe(terminal, get_color_probe, round_trip_us.value());
+      const std::optional<moo::Probe> moves = run_probe(terminal, get_move_probe, round_trip_us.value());
+      const std::optional<bool> supports_repeat = get_repeat_support(terminal);
+      terminal.clear_screen();
+      if (!text.has_value() || !colors.has_value() || !moves.has_value() || !supports_repeat.has_value())
+         return std::nullopt;
+      moo::TerminalCosts costs = moo::get_fitted_costs(text.value(), colors.value(), moves.value());
+      costs.supports_repeat = supports_repeat.value();
+      return costs;
+   }
+
+
+   /// <summary>Stands in for what the game draws: sky rows of one color each, and noisy ground that
+   /// scrolls by shift columns. Mountains in front of the sky scroll with it and break the sky rows into
+   /// runs.</summary>
+   [[nodiscard]] auto get_sample_frame(
+      const int shift,
+      const moo::ColorMode mode
+   ) -> moo::CellBuffer
+   {
+      const int sky_rows = static_cast<int>(moo::static_rows * moo::get_config().sky_fraction);
+      const int ground_rows = moo::static_rows - sky_rows;
+      moo::CellBuffer cells;
+      for (moo::LineCoordIt it = moo::get_screen_it(); it.is_valid(); ++it) {
+         moo::Cell& cell = cells[it.to_range_index()];
+         const int mountain_height = sky_rows / 2 - std::abs((it->j + shift) % 40 - 20) * sky_rows / 40;
+         if (it->i < sky_rows - mountain_height) {
+            cell = { L' ', {}, moo::get_sky_color(1.0 * it->i / sky_rows) };
+         }
+         else if (it->i < sky_rows) {
+            cell = { L' ', {}, moo::RGB{ 90, 80, 110 } };
+         }
+         else {
+            const double ground_fraction = 1.0 * (it->i - sky_rows) / ground_rows;
+            const unsigned int hash = static_cast<unsigned int>(it->i * 7919 + (it->j + shift) * 104729);
+            const moo::RGB base_color = moo::get_ground_color(ground_fraction);
+            cell = {
+               L'\u2580',
+               moo::get_offsetted_color(base_color, static_cast<int>(hash % 21) - 10),
+               moo::get_offsetted_color(base_color, static_cast<int>((hash >> 8) % 21) - 10)
+            };
+         }
+         cell.fg = moo::get_quantized_color(cell.fg, mode);
+         cell.bg = moo::get_quantized_color(cell.bg, mode);
+      }
+      return cells;
+   }
+
+
+   // Of the second of two consecutive sample frames
+   [[nodiscard]] auto get_sample_stats(
+      const bool delta_frames,
+      const bool compress_runs,
+      const moo::ColorMode mode
+   ) -> moo::FrameStats
+   {
+      moo::FrameEncoder encoder(mode);
+      encoder.m_delta_frames = delta_frames;
+      encoder.m_compress_runs = compress_runs;
+      moo::ByteBuffer str(moo::get_max_frame_size());
+      encoder.encode(get_sample_frame(0, mode), str);
+      str.clear();
+      encoder.encode(get_sample_frame(1, mode), str);
+      return {
+         static_cast<double>(str.size()),
+         static_cast<double>(encoder.get_paint_count()),
+         static_cast<double>(encoder.get_cursor_move_count())
+      };
+   }
+
+
+   // Delta frames and run compression don't change the picture, so the fastest combination wins. Ties go
+   // to the defaults. Run compression is only tried where REP works
+   [[nodiscard]] auto get_fastest_settings(
+      const moo::TerminalCosts& costs,
+      const moo::ColorMode mode
+   ) -> std::pair<moo::EncodingSettings, double>
+   {
+      moo::EncodingSettings best_settings;
+      double best_us = std::numeric_limits<double>::max();
+      for (const bool delta_frames : { true, false }) {
+         for (const bool compress_runs : { false, true }) {
+            if (compress_runs && !costs.supports_repeat)
+               continue;
+            const double us = moo::get_predicted_microseconds(costs, get_sample_stats(delta_frames, compress_runs, mode));
+            if (us < best_us) {
+               best_settings = { delta_frames, compress_runs, mode };
+               best_us = us;
+            }
+         }
+      }
+      return { best_settings, best_us };
+   }
+
+
+   [[nodiscard]] constexpr auto get_determinant(
+      const std::array<double, 3>& a,
+      const std::array<double, 3>& b,
+      const std::array<double, 3>& c
+   ) -> double
+   {
+      return a[0] * (b[1] * c[2] - b[2] * c[1]) - b[0] * (a[1] * c[2] - a[2] * c[1]) + c[0] * (a[1] * b[2] - a[2] * b[1]);
+   }
+
+} // namespace {}
+
+
+/// <summary>Solves time = bytes * byte_us + color_changes * color_change_us + cursor_moves * cursor_move_us
+/// for the three probes. Negative costs from measurement noise are treated as free.</summary>
+auto moo::get_fitted_costs(
+   const Probe& text,
+   const Probe& colors,
+   const Probe& moves
+) -> TerminalCosts
+{
+   // Columns of the system: one per unknown, rows are the probes
+   const std::array<double, 3> bytes{ text.stats.bytes, colors.stats.bytes, moves.stats.bytes };
+   const std::array<double, 3> color_changes{ text.stats.color_changes, colors.stats.color_changes, moves.stats.color_changes };
+   const std::array<double, 3> cursor_moves{ text.stats.cursor_moves, colors.stats.cursor_moves, moves.stats.cursor_moves };
+   const std::array<double, 3> times{ text.microseconds, colors.microseconds, moves.microseconds };
+   const double determinant = get_determinant(bytes, color_changes, cursor_moves);
+   if (determinant == 0.0)
+      return TerminalCosts{};
+   return TerminalCosts{
+      std::max(get_determinant(times, color_changes, cursor_moves) / determinant, 0.0),
+      std::max(get_determinant(bytes, times, cursor_moves) / determinant, 0.0),
+      std::max(get_determinant(bytes, color_changes, times) / determinant, 0.0)
+   };
+}
+
+
+auto moo::get_predicted_microseconds(
+   const TerminalCosts& costs,
+   const FrameStats& stats
+) -> double
+{
+   return stats.bytes * costs.byte_us + stats.color_changes * costs.color_change_us + stats.cursor_moves * costs.cursor_move_us;
+}
+
+
+/// <summary>Picks the fastest delta and run settings. The configured color mode is kept, unless it's true
+/// colors and those are predicted to miss 60 FPS: then the first palette mode that makes it is used, or the
+/// fastest one if none does.</summary>
+auto moo::choose_encoding_settings(
+   const TerminalCosts& costs,
+   const ColorMode configured_mode
+) -> EncodingSettings
+{
+   auto [best_settings, best_us] = get_fastest_settings(costs, configured_mode);
+   if (configured_mode != ColorMode::TrueColor || best_us <= frame_budget_us)
+      return best_settings;
+   for (const ColorMode mode : { ColorMode::Palette256, ColorMode::Palette16 }) {
+      const auto [settings, us] = get_fastest_settings(costs, mode);
+      if (us < best_us) {
+         best_settings = settings;
+         best_us = us;
+      }
+      if (us <= frame_budget_us)
+         break;
+   }
+   return best_settings;
+}
+
+
+auto moo::calibrate_encoding(const bool use_cache) -> std::optional<Calibration>{
+   const std::string terminal_name = get_terminal_name();
+   std::optional<TerminalCosts> costs;
+   if (use_cache)
+      costs = read_cached_costs(terminal_name);
+   if (!costs.has_value()) {
+      costs = measure_costs();
+      if (!costs.has_value())
+         return std::nullopt;
+      write_cached_costs(terminal_name, costs.value());
+   }
+
+   const Calibration calibration{ costs.value(), choose_encoding_settings(costs.value(), get_config().color_mode) };
+   set_encoding_settings(calibration.settings);
+   return calibration;
+}
+
+
+TEST_CASE("get_fitted_costs()") {
+   using namespace moo;
+   constexpr TerminalCosts truth{ 0.01, 0.5, 2.0 };
+   const auto get_probe = [&](const FrameStats& stats) {
+      return Probe{ stats, get_predicted_microseconds(truth, stats) };
+   };
+   const TerminalCosts fitted = get_fitted_costs(
+      get_probe({ 3603.0, 0.0, 1.0 }),
+      get_probe({ 70000.0, 3600.0, 1.0 }),
+      get_probe({ 14000.0, 0.0, 1800.0 })
+   );
+   CHECK(fitted.byte_us == doctest::Approx(truth.byte_us));
+   CHECK(fitted.color_change_us == doctest::Approx(truth.color_change_us));
+   CHECK(fitted.cursor_move_us == doctest::Approx(truth.cursor_move_us));
+}
+
+
+TEST_CASE("choose_encoding_settings()") {
+   using namespace moo;
+
+   // Only bytes cost: the sample frames are mostly unchanged
+   const EncodingSettings cheap = choose_encoding_settings({ 0.001, 0.0, 0.0, true }, ColorMode::TrueColor);
+   CHECK(cheap.delta_frames);
+   CHECK(cheap.color_mode == ColorMode::TrueColor);
+
+   // Expensive cursor moves call for full frames, with the sky runs repeated where REP works
+   const EncodingSettings jumpy = choose_encoding_settings({ 0.01, 0.0, 1.0, true }, ColorMode::TrueColor);
+   CHECK_FALSE(jumpy.delta_frames);
+   CHECK(jumpy.compress_runs);
+   const EncodingSettings no_repeat = choose_encoding_settings({ 0.01, 0.0, 1.0, false }, ColorMode::TrueColor);
+   CHECK_FALSE(no_repeat.compress_runs);
+
+   // A terminal this slow can't do true colors at 60 FPS
+   const EncodingSettings slow = choose_encoding_settings({ 0.5, 10.0, 10.0 }, ColorMode::TrueColor);
+   CHECK(slow.color_mode != ColorMode::TrueColor);
+
+   const EncodingSettings configured = choose_encoding_settings({ 0.5, 10.0, 10.0 }, ColorMode::Palette256);
+   CHECK(configured.color_mode == ColorMode::Palette256);
+}
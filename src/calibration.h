@@ -0,0 +1,44 @@
+#pragma once
+
+#include "config.h"
+
+#include <optional>
+
+
+namespace moo {
+
+   /// <summary>How long a terminal takes to process output, in microseconds per byte, per color change and
+   /// per cursor move. And if it understands REP (repeat), which not all terminals do.</summary>
+   struct TerminalCosts {
+      double byte_us = 0.0;
+      double color_change_us = 0.0;
+      double cursor_move_us = 0.0;
+      bool supports_repeat = false;
+   };
+
+   struct FrameStats {
+      double bytes = 0.0;
+      double color_changes = 0.0;
+      double cursor_moves = 0.0;
+   };
+
+   struct Probe {
+      FrameStats stats;
+      double microseconds = 0.0;
+   };
+
+   struct Calibration {
+      TerminalCosts costs;
+      EncodingSettings settings;
+   };
+
+   [[nodiscard]] auto get_fitted_costs(const Probe& text, const Probe& colors, const Probe& moves) -> TerminalCosts;
+   [[nodiscard]] auto get_predicted_microseconds(const TerminalCosts& costs, const FrameStats& stats) -> double;
+   [[nodiscard]] auto choose_encoding_settings(const TerminalCosts& costs, const ColorMode configured_mode) -> EncodingSettings;
+
+   /// <summary>Times the terminal (or reads the costs from calibration.toml if they were measured for the
+   /// same terminal before) and applies the encoding settings that are predicted to be the fastest. Empty if
+   /// the terminal can't be timed, the configured settings stay then.</summary>
+   auto calibrate_encoding(const bool use_cache) -> std::optional<Calibration>;
+
+}
@@ -0,0 +1,106 @@
+#pragma once
+
+#include "buffer.h"
+#include "color.h"
+
+#include <array>
+
+
+namespace moo {
+
+   struct Cell {
+      [[nodiscard]] constexpr auto has_fg() const -> bool;
+      [[nodiscard]] constexpr auto operator==(const Cell& other) const -> bool;
+
+      wchar_t glyph = L' ';
+      RGB fg;
+      RGB bg;
+   };
+
+   struct CellBuffer : public CharBuffer<Cell> {
+   };
+
+   struct Utf8Glyph {
+      std::array<char, 3> bytes{};
+      unsigned char length = 0;
+   };
+
+   [[nodiscard]] constexpr auto get_utf8_glyph(const wchar_t glyph) -> const Utf8Glyph&;
+
+}
+
+
+// Spaces don't show their foreground color, so it's irrelevant for them
+constexpr auto moo::Cell::has_fg() const -> bool {
+   return glyph != L' ';
+}
+
+
+constexpr auto moo::Cell::operator==(const Cell& other) const -> bool {
+   if (glyph != other.glyph || bg != other.bg)
+      return false;
+   return !has_fg() || fg == other.fg;
+}
+static_assert(moo::Cell{ L' ', {1, 2, 3}, {} } == moo::Cell{ L' ', {4, 5, 6}, {} });
+static_assert(moo::Cell{ L'x', {1, 2, 3}, {} } != moo::Cell{ L'x', {4, 5, 6}, {} });
+
+
+namespace moo::detail {
+
+   [[nodiscard]] constexpr auto get_encoded_utf8_glyph(const unsigned int code_point) -> Utf8Glyph {
+      Utf8Glyph result;
+      if (code_point < 0x80) {
+         result.bytes[0] = static_cast<char>(code_point);
+         result.length = 1;
+      }
+      else if (code_point < 0x800) {
+         result.bytes[0] = static_cast<char>(0xC0 | (code_point >> 6));
+         result.bytes[1] = static_cast<char>(0x80 | (code_point & 0x3F));
+         result.length = 2;
+      }
+      else {
+         result.bytes[0] = static_cast<char>(0xE0 | (code_point >> 12));
+         result.bytes[1] = static_cast<char>(0x80 | ((code_point >> 6) & 0x3F));
+         result.bytes[2] = static_cast<char>(0x80 | (code_point & 0x3F));
+         result.length = 3;
+      }
+      return result;
+   }
+
+
+   // Cells only contain ASCII text and block glyphs. The latter are all in the "Block Elements" range
+   // U+2580 to U+259F, so both fit in one table
+   constexpr unsigned int ascii_count = 0x80;
+   constexpr unsigned int block_elements_begin = 0x2580;
+   constexpr unsigned int block_element_count = 32;
+
+   [[nodiscard]] constexpr auto get_utf8_glyph_table() -> std::array<Utf8Glyph, ascii_count + block_element_count> {
+      std::array<Utf8Glyph, ascii_count + block_element_count> glyphs;
+      for (unsigned int i = 0; i < ascii_count; ++i)
+         glyphs[i] = get_encoded_utf8_glyph(i);
+      for (unsigned int i = 0; i < block_element_count; ++i)
+         glyphs[ascii_count + i] = get_encoded_utf8_glyph(block_elements_begin + i);
+      return glyphs;
+   }
+   constexpr std::array<Utf8Glyph, ascii_count + block_element_count> utf8_glyph_table = get_utf8_glyph_table();
+
+}
+
+
+// Returns a reference into the table on purpose: building the small struct on the fly turned out to be
+// surprisingly slow in the hot loop
+constexpr auto moo::get_utf8_glyph(const wchar_t glyph) -> const Utf8Glyph& {
+   const unsigned int code_point = static_cast<unsigned int>(glyph);
+   if (code_point < detail::ascii_count)
+      return detail::utf8_glyph_table[code_point];
+   const unsigned int block_index = code_point - detail::block_elements_begin;
+   if (block_index < detail::block_element_count)
+      return detail::utf8_glyph_table[detail::ascii_count + block_index];
+   return detail::utf8_glyph_table['?'];
+}
+static_assert(moo::get_utf8_glyph(L'x').length == 1);
+static_assert(moo::get_utf8_glyph(L'\u2580').length == 3);
+static_assert(moo::get_utf8_glyph(L'\u2580').bytes[0] == '\xE2');
+static_assert(moo::get_utf8_glyph(L'\u2580').bytes[1] == '\x96');
+static_assert(moo::get_utf8_glyph(L'\u2580').bytes[2] == '\x80');
+static_assert(moo::get_utf8_glyph(L'\u259F').bytes[2] == '\x9F');
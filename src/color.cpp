@@ -1,6 +1,9 @@
 #include "color.h"
 #include "helpers.h"
 
+#include <array>
+#include <cmath>
+
 namespace {
 
    [[nodiscard]] auto get_gradient(
@@ -41,6 +44,16 @@ namespace {
       return noised_colors;
    }
 
+
+   [[nodiscard]] auto get_linear_channels() -> std::array<double, 256> {
+      std::array<double, 256> channels;
+      for (int i = 0; i < 256; ++i) {
+         const double value = i / 255.0;
+         channels[i] = (value <= 0.04045) ? value / 12.92 : std::pow((value + 0.055) / 1.055, 2.4);
+      }
+      return channels;
+   }
+
 } // namespace {}
 
 
@@ -77,6 +90,47 @@ auto moo::get_gradient(
 }
 
 
+// See https://bottosson.github.io/posts/oklab/
+auto moo::get_oklab(const RGB& color) -> OkLab{
+   static const std::array<double, 256> linear_channels = get_linear_channels();
+   const double r = linear_channels[color.r];
+   const double g = linear_channels[color.g];
+   const double b = linear_channels[color.b];
+
+   const double l = std::cbrt(0.4122214708 * r + 0.5363325363 * g + 0.0514459929 * b);
+   const double m = std::cbrt(0.2119034982 * r + 0.6806995451 * g + 0.1073969566 * b);
+   const double s = std::cbrt(0.0883024619 * r + 0.2817188376 * g + 0.6299787005 * b);
+   return {
+      0.2104542553 * l + 0.7936177850 * m - 0.0040720468 * s,
+      1.9779984951 * l - 2.4285922050 * m + 0.4505937099 * s,
+      0.0259040371 * l + 0.7827717662 * m - 0.8086757660 * s
+   };
+}
+
+
+auto moo::get_oklab_distance(
+   const OkLab& a,
+   const OkLab& b
+) -> double
+{
+   const double dl = a.l - b.l;
+   const double da = a.a - b.a;
+   const double db = a.b - b.b;
+   return std::sqrt(dl * dl + da * da + db * db);
+}
+TEST_CASE("get_oklab()") {
+   using namespace moo;
+   CHECK(get_oklab(RGB{ 255, 255, 255 }).l == doctest::Approx(1.0).epsilon(0.001));
+   CHECK(get_oklab(RGB{ 0, 0, 0 }).l == doctest::Approx(0.0));
+
+   // Neighbouring colors are closer than anything visible
+   const double small_distance = get_oklab_distance(get_oklab(RGB{ 149, 179, 228 }), get_oklab(RGB{ 150, 179, 228 }));
+   CHECK(small_distance < 0.01);
+   const double large_distance = get_oklab_distance(get_oklab(RGB{ 149, 179, 228 }), get_oklab(RGB{ 55, 108, 48 }));
+   CHECK(large_distance > 0.1);
+}
+
+
 TEST_CASE("get_color_mix()") {
    using namespace moo;
    constexpr RGB white{ 200, 200, 200};
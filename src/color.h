@@ -2,6 +2,7 @@
 
 #include "entt_types.h"
 
+#include <algorithm>
 #include <compare>
 #include <random>
 #include <numeric>
@@ -20,19 +21,28 @@ namespace moo {
       constexpr auto operator<=>(const RGB& other) const = default;
    };
 
+   // Premultiplied: m_rgb is the color already scaled by the alpha, which is in 1/255ths
    struct RGBA {
       RGB m_rgb;
-      double m_alpha = 0.0;
+      unsigned char m_alpha = 0;
    };
 
    using TwoColors = std::pair<RGB, RGB>;
 
+   struct OkLab {
+      double l = 0.0;
+      double a = 0.0;
+      double b = 0.0;
+   };
+
    [[nodiscard]] constexpr auto operator*(const double factor, const moo::RGB& color) -> moo::RGB;
    [[nodiscard]] constexpr auto operator+(const moo::RGB& a, const moo::RGB& b) -> moo::RGB;
    [[nodiscard]] constexpr auto is_color_visible(const moo::RGB& color) -> bool;
    [[nodiscard]] auto get_noised_color(const moo::RGB& color, const int noise_strength, std::mt19937_64& rng) -> RGB;
    [[nodiscard]] constexpr auto get_offsetted_color(const moo::RGB& color, const int noise) -> RGB;
    [[nodiscard]] auto get_gradient(const RGB& from, const RGB& to, const unsigned int n) -> std::vector<RGB>;
+   [[nodiscard]] auto get_oklab(const RGB& color) -> OkLab;
+   [[nodiscard]] auto get_oklab_distance(const OkLab& a, const OkLab& b) -> double;
    [[nodiscard]] constexpr auto get_color_mix(const RGB& a, const RGB& b, const double factor) -> RGB;
    [[nodiscard]] constexpr auto get_sky_color(const double fraction)->RGB;
    [[nodiscard]] constexpr auto get_ground_color(const double fraction)->RGB;
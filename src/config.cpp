@@ -25,6 +25,23 @@ auto moo::setup_config() -> void{
    config.ufo_hit_invul_duration = tbl["game"]["ufo_hit_invul_duration"].value_or(0.1);
    config.player_hit_invul_duration = tbl["game"]["player_hit_invul_duration"].value_or(0.1);
    config.day_length = tbl["game"]["day_length"].value_or(60.0);
+   config.delta_frames = tbl["render"]["delta_frames"].value_or(true);
+   config.optimize_glyph_orientation = tbl["render"]["optimize_glyph_orientation"].value_or(true);
+   config.compress_runs = tbl["render"]["compress_runs"].value_or(false);
+   config.erase_line_ends = tbl["render"]["erase_line_ends"].value_or(true);
+   config.color_tolerance = tbl["render"]["color_tolerance"].value_or(0.0);
+   config.color_mode = get_color_mode(tbl["render"]["color_mode"].value_or("truecolor"));
+   config.cell_mode = get_cell_mode(tbl["render"]["cell_mode"].value_or("quadrants"));
+   config.dynamic_resolution = tbl["render"]["dynamic_resolution"].value_or(false);
+   config.target_fps = tbl["render"]["target_fps"].value_or(60.0);
+   config.calibrate = tbl["render"]["calibrate"].value_or(false);
+}
+
+
+auto moo::set_encoding_settings(const EncodingSettings& settings) -> void{
+   config.delta_frames = settings.delta_frames;
+   config.compress_runs = settings.compress_runs;
+   config.color_mode = settings.color_mode;
 }
 
 
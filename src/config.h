@@ -1,9 +1,18 @@
 #pragma once
 
+#include "block_cell.h"
 #include "helpers.h"
+#include "palette.h"
 
 namespace moo {
 
+   /// <summary>The render settings that the startup calibration may choose instead of config.toml</summary>
+   struct EncodingSettings {
+      bool delta_frames = true;
+      bool compress_runs = false;
+      ColorMode color_mode = ColorMode::TrueColor;
+   };
+
    struct Config {
       double gravity_strength = 0.0;
       double horizontal_cage_padding = 0.0;
@@ -18,9 +27,20 @@ namespace moo {
       double ufo_shooting_interal = 1.0;
       double ufo_base_speed = 0.1;
       double ufo_speed_increment = 0.1;
+      bool delta_frames = true;
+      bool optimize_glyph_orientation = true;
+      bool compress_runs = false;
+      bool erase_line_ends = true;
+      double color_tolerance = 0.0;
+      ColorMode color_mode = ColorMode::TrueColor;
+      CellMode cell_mode = CellMode::Quadrants;
+      bool dynamic_resolution = false;
+      double target_fps = 60.0;
+      bool calibrate = false;
    };
 
    auto setup_config() -> void;
+   auto set_encoding_settings(const EncodingSettings& settings) -> void;
    auto get_config() -> const Config&;
 
 }
@@ -0,0 +1,101 @@
+#include "damage.h"
+
+#include <doctest/doctest.h>
+
+
+moo::DamageTracker::DamageTracker()
+   : m_current(static_rows)
+   , m_previous(static_rows)
+{
+
+}
+
+
+auto moo::DamageTracker::add(const LineCoord& pos) -> void{
+   add(pos, pos + LineCoord{ 1, 1 });
+}
+
+
+// The bottom right is exclusive. Everything off screen is ignored.
+auto moo::DamageTracker::add(
+   const LineCoord& top_left,
+   const LineCoord& bottom_right
+) -> void
+{
+   const ColumnRange range{ std::max(top_left.j, 0), std::min(bottom_right.j, static_columns) };
+   if (range.is_empty())
+      return;
+   const int end_i = std::min(bottom_right.i, static_rows);
+   for (int i = std::max(top_left.i, 0); i < end_i; ++i)
+      m_current[i] = m_current[i].get_united(range);
+}
+
+
+auto moo::DamageTracker::add_rows(const int begin_i, const int end_i) -> void{
+   add(LineCoord{ begin_i, 0 }, LineCoord{ end_i, static_columns });
+}
+
+
+auto moo::DamageTracker::add_all() -> void{
+   add_rows(0, static_rows);
+}
+
+
+auto moo::DamageTracker::next_frame() -> void{
+   std::swap(m_previous, m_current);
+   std::fill(m_current.begin(), m_current.end(), ColumnRange{});
+}
+
+
+auto moo::DamageTracker::get_previous(const int i) const -> ColumnRange{
+   return m_previous[i];
+}
+
+
+auto moo::DamageTracker::get_damage(const int i) const -> ColumnRange{
+   return m_current[i].get_united(m_previous[i]);
+}
+
+
+auto moo::DamageTracker::is_damaged(const LineCoord& pos) const -> bool{
+   return get_damage(pos.i).contains(pos.j);
+}
+
+
+auto moo::DamageTracker::get_damaged_count() const -> size_t{
+   size_t count = 0;
+   for (int i = 0; i < static_rows; ++i) {
+      const ColumnRange damage = get_damage(i);
+      if (!damage.is_empty())
+         count += damage.end_j - damage.begin_j;
+   }
+   return count;
+}
+
+
+TEST_CASE("DamageTracker") {
+   using namespace moo;
+   DamageTracker tracker;
+   CHECK(tracker.get_damaged_count() == 0);
+
+   // Rectangles get clipped to the screen
+   tracker.add(LineCoord{ -2, 5 }, LineCoord{ 2, 10 });
+   tracker.add(LineCoord{ 1, static_columns - 1 }, LineCoord{ 2, static_columns + 5 });
+   CHECK(tracker.get_damage(0) == ColumnRange{ 5, 10 });
+   CHECK(tracker.get_damage(1) == ColumnRange{ 5, static_columns });
+   CHECK(tracker.get_damage(2).is_empty());
+   CHECK(tracker.is_damaged(LineCoord{ 0, 9 }));
+   CHECK_FALSE(tracker.is_damaged(LineCoord{ 0, 10 }));
+
+   // The last frame stays damaged for one more frame
+   tracker.next_frame();
+   tracker.add(LineCoord{ 0, 20 });
+   CHECK(tracker.get_previous(0) == ColumnRange{ 5, 10 });
+   CHECK(tracker.get_damage(0) == ColumnRange{ 5, 21 });
+   tracker.next_frame();
+   tracker.next_frame();
+   CHECK(tracker.get_damaged_count() == 0);
+
+   tracker.add_all();
+   CHECK(tracker.get_damaged_count() == get_char_count());
+}
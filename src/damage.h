@@ -0,0 +1,67 @@
+#pragma once
+
+#include "cc.h"
+
+#include <algorithm>
+#include <vector>
+
+
+namespace moo {
+
+   // Columns [begin_j, end_j) of one row
+   struct ColumnRange {
+      int begin_j = 0;
+      int end_j = 0;
+
+      [[nodiscard]] constexpr auto is_empty() const -> bool;
+      [[nodiscard]] constexpr auto contains(const int j) const -> bool;
+      [[nodiscard]] constexpr auto get_united(const ColumnRange& other) const -> ColumnRange;
+      constexpr auto operator<=>(const ColumnRange& other) const = default;
+   };
+
+   /// <summary>Remembers which cells of a screen-sized buffer were written, as one range of columns per row.
+   /// A rectangle becomes the same range in each of its rows. The damage of a frame is what was written in it
+   /// plus what was written in the frame before, which is what needs to be redrawn or cleared.</summary>
+   struct DamageTracker {
+      DamageTracker();
+
+      auto add(const LineCoord& pos) -> void;
+      auto add(const LineCoord& top_left, const LineCoord& bottom_right) -> void;
+      auto add_rows(const int begin_i, const int end_i) -> void;
+      auto add_all() -> void;
+
+      // What was written so far becomes the previous frame
+      auto next_frame() -> void;
+
+      [[nodiscard]] auto get_previous(const int i) const -> ColumnRange;
+      [[nodiscard]] auto get_damage(const int i) const -> ColumnRange;
+      [[nodiscard]] auto is_damaged(const LineCoord& pos) const -> bool;
+      [[nodiscard]] auto get_damaged_count() const -> size_t;
+
+   private:
+      std::vector<ColumnRange> m_current;
+      std::vector<ColumnRange> m_previous;
+   };
+
+}
+
+
+constexpr auto moo::ColumnRange::is_empty() const -> bool {
+   return begin_j >= end_j;
+}
+
+
+constexpr auto moo::ColumnRange::contains(const int j) const -> bool {
+   return j >= begin_j && j < end_j;
+}
+
+
+constexpr auto moo::ColumnRange::get_united(const ColumnRange& other) const -> ColumnRange {
+   if (is_empty())
+      return other;
+   if (other.is_empty())
+      return *this;
+   return { std::min(begin_j, other.begin_j), std::max(end_j, other.end_j) };
+}
+static_assert(moo::ColumnRange{ 2, 4 }.get_united({ 6, 8 }) == moo::ColumnRange{ 2, 8 });
+static_assert(moo::ColumnRange{}.get_united({ 6, 8 }) == moo::ColumnRange{ 6, 8 });
@@ -21,7 +21,7 @@ namespace moo {
    ) -> entt::entity
    {
       const auto view = registry.view<T>();
-      const std::uniform_int_distribution<> index_dist(0, get_view_size(view) - 1);
+      std::uniform_int_distribution<> index_dist(0, get_view_size(view) - 1);
       auto it = view.begin();
       const auto index = index_dist(moo::get_rng());
       for (int i = 0; i < index; ++i)
@@ -10,13 +10,15 @@ moo::FpsCounter::FpsCounter()
 }
 
 
-void moo::FpsCounter::step(const tp& now){
+bool moo::FpsCounter::step(const tp& now){
    ++m_fps_count;
 
    const std::chrono::duration<double> passed_duration(now - m_last_tp);
    constexpr std::chrono::milliseconds one_second(1000);
-   if (passed_duration > one_second)
-      reset(now);
+   if (passed_duration <= one_second)
+      return false;
+   reset(now);
+   return true;
 }
 
 
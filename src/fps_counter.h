@@ -8,7 +8,7 @@ namespace moo {
       using tp = std::chrono::time_point<std::chrono::system_clock>;
 
       FpsCounter();
-      void step(const tp& now);
+      bool step(const tp& now); // True when there's a new measurement
 
       double m_current_fps = 0;
 
@@ -0,0 +1,413 @@
+#include "frame_encoder.h"
+
+#include "config.h"
+
+#include <string_view>
+
+#include <doctest/doctest.h>
+#include <Tracy.hpp>
+
+
+namespace {
+
+   // Frames are wrapped in synchronized updates (DEC mode 2026), so that terminals supporting it present them
+   // at once instead of while parsing. Others ignore it. The cursor homing is part of the frame as well, which
+   // makes a frame exactly one write.
+   constexpr std::string_view frame_begin = "\x1b[?2026h\x1b[H";
+   constexpr std::string_view frame_end = "\x1b[?2026l";
+
+
+   [[nodiscard]] constexpr auto get_digit_count(const int number) -> size_t {
+      size_t digits = 1;
+      for (int rest = number / 10; rest > 0; rest /= 10)
+         ++digits;
+      return digits;
+   }
+   static_assert(get_digit_count(0) == 1);
+   static_assert(get_digit_count(9) == 1);
+   static_assert(get_digit_count(120) == 3);
+
+
+   // CSI n C
+   [[nodiscard]] constexpr auto get_cursor_forward_length(const int n) -> size_t {
+      return 3 + get_digit_count(n);
+   }
+
+
+   // CSI row ; column H, both one-based
+   [[nodiscard]] constexpr auto get_cursor_position_length(const moo::LineCoord& pos) -> size_t {
+      return 4 + get_digit_count(pos.i + 1) + get_digit_count(pos.j + 1);
+   }
+
+
+   // CSI n b, repeats the last printed character n times
+   [[nodiscard]] constexpr auto get_repeat_length(const int n) -> size_t {
+      return 3 + get_digit_count(n);
+   }
+
+
+   // Erases to the end of the line with the current background. The cursor stays where it is, so the next
+   // row has to be started with a CR LF instead of by wrapping
+   constexpr std::string_view erase_line = "\x1b[K";
+   constexpr std::string_view next_line = "\r\n";
+
+
+   auto append_cursor_forward(const int n, moo::ByteBuffer& target) -> void {
+      target += "\x1b[";
+      moo::append_decimal(n, target);
+      target += 'C';
+   }
+
+
+   auto append_repeat(const int n, moo::ByteBuffer& target) -> void {
+      target += "\x1b[";
+      moo::append_decimal(n, target);
+      target += 'b';
+   }
+
+
+   auto append_cursor_position(const moo::LineCoord& pos, moo::ByteBuffer& target) -> void {
+      target += "\x1b[";
+      moo::append_decimal(pos.i + 1, target);
+      target += ';';
+      moo::append_decimal(pos.j + 1, target);
+      target += 'H';
+   }
+
+
+   auto write_cell(
+      const moo::Cell& cell,
+      moo::Painter& painter,
+      moo::ByteBuffer& target
+   ) -> void
+   {
+      painter.paint_layer(cell.bg, moo::Layer::Back, target);
+      if (cell.has_fg())
+         painter.paint_layer(cell.fg, moo::Layer::Front, target);
+      const moo::Utf8Glyph& glyph = moo::get_utf8_glyph(cell.glyph);
+      target.append_padded(glyph.bytes, glyph.length);
+   }
+
+
+   [[nodiscard]] auto get_row_cells(
+      const moo::CellBuffer& cells,
+      const int i,
+      const int begin_j,
+      const int end_j
+   ) -> std::span<const moo::Cell>
+   {
+      const size_t begin = moo::to_screen_index(moo::LineCoord{ i, begin_j });
+      return { cells.m_colors.data() + begin, static_cast<size_t>(end_j - begin_j) };
+   }
+
+} // namespace {}
+
+
+moo::FrameEncoder::FrameEncoder()
+   : FrameEncoder(get_config().color_mode)
+{
+
+}
+
+
+moo::FrameEncoder::FrameEncoder(const ColorMode color_mode)
+   : m_delta_frames(get_config().delta_frames)
+   , m_optimize_glyph_orientation(get_config().optimize_glyph_orientation)
+   , m_compress_runs(get_config().compress_runs)
+   , m_erase_line_ends(get_config().erase_line_ends)
+   , m_painter(get_config().color_tolerance, color_mode)
+{
+
+}
+
+
+auto moo::get_max_frame_size() -> size_t{
+   // two color changes, a cursor jump and a three byte glyph per cell is plenty
+   constexpr size_t max_cell_size = 64;
+   return get_char_count() * max_cell_size;
+}
+
+
+auto moo::FrameEncoder::encode(
+   const CellBuffer& cells,
+   ByteBuffer& target
+) -> void
+{
+   ZoneScoped;
+   m_painter.reset_paint_count();
+   m_cursor_moves = 0;
+   const size_t size_before = target.size();
+   target += frame_begin;
+   const size_t content_begin = target.size();
+   if (m_delta_frames && m_last_frame_valid) {
+      encode_delta(cells, target);
+
+      // Against the last full frame. Encoding this one in full as well would cost more than the delta saves
+      m_bytes_saved = static_cast<int>(m_full_frame_size) - static_cast<int>(target.size() - content_begin);
+   }
+   else {
+      encode_full(cells, target);
+      m_full_frame_size = target.size() - content_begin;
+      m_bytes_saved = 0;
+   }
+   m_last_frame = cells;
+   m_last_frame_valid = true;
+
+   // Without changes, there's nothing to write at all
+   if (target.size() == content_begin)
+      target.truncate(size_before);
+   else
+      target += frame_end;
+}
+
+
+auto moo::FrameEncoder::get_paint_count() const -> unsigned int{
+   return m_painter.get_paint_count();
+}
+
+
+auto moo::FrameEncoder::get_cursor_move_count() const -> unsigned int{
+   return m_cursor_moves;
+}
+
+
+auto moo::FrameEncoder::get_bytes_saved() const -> int{
+   return m_bytes_saved;
+}
+
+
+auto moo::FrameEncoder::encode_full(
+   const CellBuffer& cells,
+   ByteBuffer& target
+) -> void
+{
+   m_cursor_moves += write_rows(cells, m_painter, target);
+}
+
+
+auto moo::FrameEncoder::encode_delta(
+   const CellBuffer& cells,
+   ByteBuffer& target
+) -> void
+{
+   // Every frame starts with the cursor homed
+   m_cursor = { 0, 0 };
+   m_cursor_movable = true;
+   for (int i = 0; i < static_rows; ++i) {
+      int j = 0;
+      while (j < static_columns) {
+         const auto is_changed = [&](const int column) {
+            const size_t index = to_screen_index(LineCoord{ i, column });
+            return cells[index] != m_last_frame[index];
+         };
+         if (!is_changed(j)) {
+            ++j;
+            continue;
+         }
+
+         // Changed cells get written in runs so their orientation can be planned together
+         int run_end = j + 1;
+         while (run_end < static_columns && is_changed(run_end))
+            ++run_end;
+         // Without a move, the cursor may still be waiting on the previous row's last column
+         const bool wrap_pending = !m_cursor_movable && m_cursor == LineCoord{ i, j };
+         move_cursor(LineCoord{ i, j }, cells, target);
+         const bool ends_row = run_end == static_columns;
+         if (write_cells(get_row_cells(cells, i, j, run_end), m_painter, target, ends_row, wrap_pending)) {
+            // The cursor stayed somewhere in the erased row. The next change is on a later row, so the
+            // next move is a jump either way
+            m_cursor = { i, static_columns };
+            m_cursor_movable = false;
+         }
+         else {
+            advance_cursor(LineCoord{ i, run_end - 1 });
+         }
+         j = run_end;
+      }
+   }
+}
+
+
+/// <summary>Picks the cheapest way to get the cursor to pos: a jump, a forward move or re-printing the
+/// (unchanged) cells in between if that takes fewer characters.</summary>
+auto moo::FrameEncoder::move_cursor(
+   const LineCoord& pos,
+   const CellBuffer& cells,
+   ByteBuffer& target
+) -> void
+{
+   if (m_cursor == pos)
+      return;
+   size_t best_move_length = get_cursor_position_length(pos);
+   const bool same_row_ahead = m_cursor.i == pos.i && m_cursor.j < pos.j;
+   if (same_row_ahead) {
+      const int gap = pos.j - m_cursor.j;
+      if (m_cursor_movable)
+         best_move_length = std::min(best_move_length, get_cursor_forward_length(gap));
+
+      // every cell is at least one character, so only short gaps can be worth re-printing
+      if (static_cast<size_t>(gap) < best_move_length) {
+         Painter painter_copy = m_painter;
+         const size_t size_before = target.size();
+         for (int j = m_cursor.j; j < pos.j; ++j)
+            write_cell(cells[to_screen_index(LineCoord{ pos.i, j })], painter_copy, target);
+         if (target.size() - size_before <= best_move_length) {
+            m_painter = painter_copy;
+            return;
+         }
+         target.truncate(size_before);
+      }
+      if (m_cursor_movable && get_cursor_forward_length(gap) == best_move_length) {
+         append_cursor_forward(gap, target);
+         ++m_cursor_moves;
+         return;
+      }
+   }
+   append_cursor_position(pos, target);
+   ++m_cursor_moves;
+}
+
+
+auto moo::FrameEncoder::advance_cursor(const LineCoord& written_pos) -> void{
+   // After the last column, the cursor waits for the next character to wrap. Only printing works from there.
+   const bool was_last_column = written_pos.j == static_columns - 1;
+   if (was_last_column)
+      m_cursor = { written_pos.i + 1, 0 };
+   else
+      m_cursor = { written_pos.i, written_pos.j + 1 };
+   m_cursor_movable = !was_last_column;
+}
+
+
+// Returns how many rows had to be started with a CR LF
+auto moo::FrameEncoder::write_rows(
+   const CellBuffer& cells,
+   Painter& painter,
+   ByteBuffer& target
+) -> unsigned int
+{
+   unsigned int line_starts = 0;
+   bool wrap_pending = false;
+   for (int i = 0; i < static_rows; ++i) {
+      const bool erased = write_cells(get_row_cells(cells, i, 0, static_columns), painter, target, true, wrap_pending);
+      if (erased && i < static_rows - 1) {
+         target += next_line;
+         ++line_starts;
+      }
+      wrap_pending = !erased;
+   }
+   return line_starts;
+}
+
+
+/// <summary>Runs of identical cells are printed once and then repeated with REP, if m_compress_runs is on.
+/// If the cells end the row and are blank, they can be erased with EL instead (m_erase_line_ends). Returns if that happened, the cursor is then still in
+/// the row. With a wrap pending, the cursor is still on the last column of the row before. An EL there would
+/// erase that cell, so the first cell has to be printed to get into the row.</summary>
+auto moo::FrameEncoder::write_cells(
+   const std::span<const Cell> cells,
+   Painter& painter,
+   ByteBuffer& target,
+   const bool ends_row,
+   const bool wrap_pending
+) -> bool
+{
+   const std::span<const Cell> planned = m_optimize_glyph_orientation ? m_row_planner.plan(cells, painter) : cells;
+   if (!m_compress_runs && !m_erase_line_ends) {
+      for (const Cell& cell : planned)
+         write_cell(cell, painter, target);
+      return false;
+   }
+
+   size_t begin = 0;
+   while (begin < planned.size()) {
+      const Cell& cell = planned[begin];
+      size_t end = begin + 1;
+      while (end < planned.size() && planned[end] == cell)
+         ++end;
+      const int run_length = static_cast<int>(end - begin);
+      const bool can_erase = m_erase_line_ends && ends_row && end == planned.size() && !cell.has_fg() && !(wrap_pending && begin == 0);
+      if (!can_erase && (run_length == 1 || !m_compress_runs)) {
+         for (size_t index = begin; index < end; ++index)
+            write_cell(planned[index], painter, target);
+         begin = end;
+         continue;
+      }
+
+      const Utf8Glyph& glyph = get_utf8_glyph(cell.glyph);
+      const size_t print_length = glyph.length * static_cast<size_t>(run_length);
+      const size_t repeat_length = glyph.length + get_repeat_length(run_length - 1);
+      const bool repeat = m_compress_runs && run_length > 1 && repeat_length < print_length;
+      const size_t write_length = repeat ? repeat_length : print_length;
+      if (can_erase && erase_line.size() + next_line.size() < write_length) {
+         painter.paint_layer(cell.bg, Layer::Back, target);
+         target += erase_line;
+         return true;
+      }
+
+      write_cell(cell, painter, target);
+      if (repeat)
+         append_repeat(run_length - 1, target);
+      else {
+         for (int i = 1; i < run_length; ++i)
+            target.append_padded(glyph.bytes, glyph.length);
+      }
+      begin = end;
+   }
+   return false;
+}
+
+
+TEST_CASE("FrameEncoder delta frames") {
+   using namespace moo;
+   FrameEncoder encoder;
+   encoder.m_delta_frames = true;
+   encoder.m_compress_runs = false;
+   encoder.m_erase_line_ends = false;
+   CellBuffer cells;
+   ByteBuffer str(get_max_frame_size());
+   encoder.encode(cells, str);
+   CHECK(str.size() == frame_begin.size() + get_char_count() + frame_end.size());
+   CHECK(str.get_view().starts_with(frame_begin));
+   CHECK(str.get_view().ends_with(frame_end));
+
+   str.clear();
+   encoder.encode(cells, str);
+   CHECK(str.empty());
+
+   cells[to_screen_index(LineCoord{ 2, 5 })].glyph = L'x';
+   cells[to_screen_index(LineCoord{ 2, 7 })].glyph = L'y';
+   str.clear();
+   encoder.encode(cells, str);
+   CHECK(str.get_view() == "\x1b[?2026h\x1b[H\x1b[3;6H\x1b[38;2;0;0;0mx y\x1b[?2026l");
+   CHECK(encoder.get_bytes_saved() > 0);
+}
+
+
+TEST_CASE("FrameEncoder run compression") {
+   using namespace moo;
+   FrameEncoder encoder;
+   encoder.m_delta_frames = false;
+   encoder.m_optimize_glyph_orientation = false;
+   encoder.m_compress_runs = true;
+   encoder.m_erase_line_ends = true;
+   CellBuffer cells;
+   for (int j = 0; j < 10; ++j)
+      cells[to_screen_index(LineCoord{ 0, j })] = Cell{ L'x', {255, 0, 0}, {0, 0, 0} };
+   ByteBuffer str(get_max_frame_size());
+   encoder.encode(cells, str);
+
+   std::string expected(frame_begin);
+   expected += "\x1b[38;2;255;0;0mx\x1b[9b\x1b[K\r\n";
+   for (int i = 1; i < static_rows - 1; ++i)
+      expected += "\x1b[K\r\n";
+   expected += "\x1b[K";
+   expected += frame_end;
+   CHECK(str.get_view() == expected);
+
+   // Without REP, only the blank line ends are erased
+   encoder.m_compress_runs = false;
+   str.clear();
+   encoder.encode(cells, str);
+   CHECK(str.get_view().find("xxxxxxxxxx\x1b[K\r\n") != std::string_view::npos);
+}
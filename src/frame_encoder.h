@@ -0,0 +1,48 @@
+#pragma once
+
+#include "cc.h"
+#include "cell.h"
+#include "painter.h"
+#include "row_planner.h"
+
+
+
+namespace moo {
+
+   [[nodiscard]] auto get_max_frame_size() -> size_t;
+
+   /// <summary>Turns a grid of cells into the UTF-8 VT string that gets written to the console. In delta mode,
+   /// only the cells that changed since the last frame are written, with cursor jumps in between.</summary>
+   struct FrameEncoder {
+      FrameEncoder();
+      explicit FrameEncoder(const ColorMode color_mode);
+      auto encode(const CellBuffer& cells, ByteBuffer& target) -> void;
+      [[nodiscard]] auto get_paint_count() const -> unsigned int;
+      [[nodiscard]] auto get_cursor_move_count() const -> unsigned int;
+      [[nodiscard]] auto get_bytes_saved() const -> int;
+
+      bool m_delta_frames = true;
+      bool m_optimize_glyph_orientation = true;
+      bool m_compress_runs = false;
+      bool m_erase_line_ends = true;
+
+   private:
+      auto encode_full(const CellBuffer& cells, ByteBuffer& target) -> void;
+      auto encode_delta(const CellBuffer& cells, ByteBuffer& target) -> void;
+      auto move_cursor(const LineCoord& pos, const CellBuffer& cells, ByteBuffer& target) -> void;
+      auto advance_cursor(const LineCoord& written_pos) -> void;
+      auto write_rows(const CellBuffer& cells, Painter& painter, ByteBuffer& target) -> unsigned int;
+      auto write_cells(const std::span<const Cell> cells, Painter& painter, ByteBuffer& target, const bool ends_row, const bool wrap_pending) -> bool;
+
+      Painter m_painter;
+      RowPlanner m_row_planner;
+      CellBuffer m_last_frame;
+      bool m_last_frame_valid = false;
+      LineCoord m_cursor;
+      bool m_cursor_movable = true;
+      size_t m_full_frame_size = 0;
+      int m_bytes_saved = 0;
+      unsigned int m_cursor_moves = 0;
+   };
+
+}
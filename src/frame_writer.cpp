@@ -0,0 +1,135 @@
+#include "frame_writer.h"
+
+#include <doctest/doctest.h>
+#include <Tracy.hpp>
+
+
+namespace {
+
+   constexpr int index_mask = 0b11;
+   constexpr int new_frame_flag = 0b100;
+   constexpr int stop_flag = 0b1000;
+
+   constexpr std::chrono::seconds write_measurement_period{ 1 };
+
+} // namespace {}
+
+
+moo::FrameWriter::FrameWriter(const FrameTarget target)
+   : m_target(target)
+   , m_output_string(get_max_frame_size())
+{
+   if (std::holds_alternative<Terminal*>(m_target))
+      m_thread = std::jthread([this](const std::stop_token stop_token) {run(stop_token); });
+}
+
+
+moo::FrameWriter::~FrameWriter() {
+   stop();
+}
+
+
+auto moo::FrameWriter::get_back_buffer() -> CellBuffer&{
+   return m_buffers[m_back_index];
+}
+
+
+auto moo::FrameWriter::submit() -> void{
+   if (std::holds_alternative<HeadlessTarget*>(m_target)) {
+      write_frame(m_buffers[m_back_index]);
+      return;
+   }
+   const int previous_middle = m_middle.exchange(m_back_index | new_frame_flag, std::memory_order_acq_rel);
+   m_back_index = previous_middle & index_mask;
+   m_middle.notify_one();
+}
+
+
+// Waits for the frame that's being written. One that's still waiting is dropped
+auto moo::FrameWriter::stop() -> void{
+   if (!m_thread.joinable())
+      return;
+   m_thread.request_stop();
+   m_middle.fetch_or(stop_flag, std::memory_order_acq_rel);
+   m_middle.notify_one();
+   m_thread.join();
+}
+
+
+auto moo::FrameWriter::get_paint_count() const -> unsigned int{
+   return m_paint_count.load(std::memory_order_relaxed);
+}
+
+
+auto moo::FrameWriter::get_bytes_saved() const -> int{
+   return m_bytes_saved.load(std::memory_order_relaxed);
+}
+
+
+// How many frames per second could be written if the writer never had to wait for the game. Unlike the
+// game's frame rate, that's what the resolution scale changes. Zero until the first measurement.
+auto moo::FrameWriter::get_write_fps() const -> double{
+   return m_write_fps.load(std::memory_order_relaxed);
+}
+
+
+auto moo::FrameWriter::run(const std::stop_token stop_token) -> void{
+   while (!stop_token.stop_requested()) {
+      const int middle = m_middle.load(std::memory_order_acquire);
+      if ((middle & stop_flag) != 0)
+         return;
+      if ((middle & new_frame_flag) == 0) {
+         m_middle.wait(middle, std::memory_order_acquire);
+         continue;
+      }
+
+      // Take the new frame and leave the old one for the game to fill
+      m_front_index = m_middle.exchange(m_front_index, std::memory_order_acq_rel) & index_mask;
+      write_frame(m_buffers[m_front_index]);
+   }
+}
+
+
+auto moo::FrameWriter::write_frame(const CellBuffer& cells) -> void{
+   ZoneScopedN("Writing frame");
+   const auto begin = std::chrono::steady_clock::now();
+   m_output_string.clear();
+   m_encoder.encode(cells, m_output_string);
+
+   // The frame brings its own cursor homing, so this is the only write. Unchanged frames are empty and
+   // skipped, except for headless targets. Those count every frame.
+   if (!m_output_string.empty() || std::holds_alternative<HeadlessTarget*>(m_target))
+      std::visit([&](auto* target) {target->write(m_output_string.get_view()); }, m_target);
+   m_paint_count.store(m_encoder.get_paint_count(), std::memory_order_relaxed);
+   m_bytes_saved.store(m_encoder.get_bytes_saved(), std::memory_order_relaxed);
+   measure_write(begin);
+}
+
+
+auto moo::FrameWriter::measure_write(const std::chrono::steady_clock::time_point& begin) -> void{
+   const auto end = std::chrono::steady_clock::now();
+   m_write_duration += end - begin;
+   ++m_measured_frames;
+   if (end - m_measurement_begin < write_measurement_period || m_write_duration.count() <= 0.0)
+      return;
+   m_write_fps.store(m_measured_frames / m_write_duration.count(), std::memory_order_relaxed);
+   m_measurement_begin = end;
+   m_write_duration = std::chrono::duration<double>{ 0.0 };
+   m_measured_frames = 0;
+}
+TEST_CASE("FrameWriter headless") {
+   using namespace moo;
+   HeadlessTarget target;
+   {
+      FrameWriter writer(&target);
+      writer.get_back_buffer()[0].glyph = L'x';
+      writer.submit();
+      writer.submit();
+   }
+
+   // The unchanged second frame is still a frame
+   REQUIRE(target.get_frame_sizes().size() == 2);
+   CHECK(target.get_frame_sizes()[0] > 0);
+   CHECK(target.get_frame_sizes()[1] == 0);
+   CHECK(target.get_cells()[0].glyph == L'x');
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include "byte_buffer.h"
+#include "cell.h"
+#include "frame_encoder.h"
+#include "headless_target.h"
+#include "terminal.h"
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <variant>
+
+
+namespace moo {
+
+   using FrameTarget = std::variant<Terminal*, HeadlessTarget*>;
+
+   /// <summary>Encodes and writes frames on its own thread, so the game can build the next frame while the
+   /// console is busy. The game fills the back buffer and submits it. The handoff is a lock-free triple
+   /// buffer: if the writer falls behind, a newer frame replaces the one that's waiting.
+   /// Headless targets are written to right away on submit(), so that no frame gets dropped.</summary>
+   struct FrameWriter {
+      explicit FrameWriter(const FrameTarget target);
+      ~FrameWriter();
+      FrameWriter(const FrameWriter& copy) = delete;
+      FrameWriter& operator=(const FrameWriter& copy) = delete;
+
+      [[nodiscard]] auto get_back_buffer() -> CellBuffer&;
+      auto submit() -> void;
+      auto stop() -> void;
+      [[nodiscard]] auto get_paint_count() const -> unsigned int;
+      [[nodiscard]] auto get_bytes_saved() const -> int;
+      [[nodiscard]] auto get_write_fps() const -> double;
+
+   private:
+      auto run(const std::stop_token stop_token) -> void;
+      auto write_frame(const CellBuffer& cells) -> void;
+      auto measure_write(const std::chrono::steady_clock::time_point& begin) -> void;
+
+      FrameTarget m_target;
+      FrameEncoder m_encoder;
+      ByteBuffer m_output_string;
+      std::array<CellBuffer, 3> m_buffers;
+      int m_back_index = 0; // game thread only
+      int m_front_index = 1; // writer thread only
+      std::atomic<int> m_middle = 2; // the buffer in between, plus flags
+      std::atomic<unsigned int> m_paint_count = 0;
+      std::atomic<int> m_bytes_saved = 0;
+
+      // Time spent encoding and writing, for the frames since the measurement began. Writer thread only
+      std::chrono::steady_clock::time_point m_measurement_begin = std::chrono::steady_clock::now();
+      std::chrono::duration<double> m_write_duration{ 0.0 };
+      int m_measured_frames = 0;
+      std::atomic<double> m_write_fps = 0.0;
+      std::jthread m_thread;
+   };
+
+}
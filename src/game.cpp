@@ -3,12 +3,15 @@
 namespace fs = std::filesystem;
 #include <random>
 
+#include "blend.h"
+#include "block_cell.h"
 #include "config.h"
 #include "entt_helper.h"
 #include "entt_types.h"
 #include "game.h"
 #include "gameplay.h"
 #include "helpers.h"
+#include "layer_blending.h"
 #include "rng.h"
 #include "tweening.h"
 #include "trail.h"
@@ -19,107 +22,23 @@ namespace fs = std::filesystem;
 
 namespace {
 
-   struct CharAndColor {
-      wchar_t ch = '\0';
-      moo::RGB color;
-   };
-   
-
-   template<typename T>
-   constexpr wchar_t get_block_glyph(
-      const moo::BlockChar& block_char,
-      const T& pred
-   ) {
-      const bool tl = pred(block_char.top_left);
-      const bool tr = pred(block_char.top_right);
-      const bool bl = pred(block_char.bottom_left);
-      const bool br = pred(block_char.bottom_right);
-
-      if (!tl && !tr && !bl && !br)
-         return L' ';
-      else if (tl && tr && bl && br)
-         return L'█';
-
-      else if (!tl && !tr && !bl && br)
-         return L'▗';
-      else if (!tl && !tr && bl && !br)
-         return L'▖';
-      else if (!tl && tr && !bl && !br)
-         return L'▝';
-      else if (tl && !tr && !bl && !br)
-         return L'▘';
-
-      else if (tl && !tr && !bl && br)
-         return L'▚';
-      else if (!tl && tr && bl && !br)
-         return L'▞';
-
-      else if (tl && tr && !bl && !br)
-         return L'▀';
-      else if (!tl && !tr && bl && br)
-         return L'▄';
-      else if (tl && !tr && bl && !br)
-         return L'▌';
-      else if (!tl && tr && !bl && br)
-         return L'▐';
-
-      else if (tl && tr && bl && !br)
-         return L'▛';
-      else if (tl && tr && !bl && br)
-         return L'▜';
-      else if (tl && !tr && bl && br)
-         return L'▙';
-      else if (!tl && tr && bl && br)
-         return L'▟';
-
-      printf("This shouldn't happen\n");
-      std::terminate();
-   }
-   static_assert(get_block_glyph({ {1, 0, 0}, {1, 0, 0}, {0, 0, 0}, {0, 0, 0} }, moo::is_color_visible) == L'▀');
-
-
-   constexpr CharAndColor get_cell_char(
-      const moo::BlockChar& block_char
-   ) {
-      if (block_char.is_all_invisible())
-         return { ' ', moo::RGB{} };
-
-      CharAndColor ret;
-      ret.ch = get_block_glyph(block_char, moo::is_color_visible);
-      ret.color = block_char.get_best_color();
-
-      return ret;
-   }
-
-
-   auto is_esc_pressed() -> bool {
-      const bool esc_pressed = GetKeyState(VK_ESCAPE) < 0;
-      return esc_pressed;
-   }
-
-
-   [[nodiscard]] auto get_keyboard_intention() -> std::optional<moo::ScreenCoord> {
-      const bool a_pressed = GetKeyState(0x41) < 0 || GetKeyState(VK_LEFT) < 0;
-      const bool d_pressed = GetKeyState(0x44) < 0 || GetKeyState(VK_RIGHT) < 0;;
-      const bool w_pressed = GetKeyState(0x57) < 0 || GetKeyState(VK_UP) < 0;;
-      const bool s_pressed = GetKeyState(0x53) < 0 || GetKeyState(VK_DOWN) < 0;;
-
+   [[nodiscard]] auto get_keyboard_intention(const moo::Input& input) -> std::optional<moo::ScreenCoord> {
       moo::ScreenCoord intention;
       constexpr double intention_span = 0.1;
       bool something_pressed = false;
-      if (a_pressed) {
+      if (input.left_pressed) {
          intention.x -= intention_span;
          something_pressed = true;
       }
-      if (d_pressed) {
+      if (input.right_pressed) {
          intention.x += intention_span;
          something_pressed = true;
       }
-      if (w_pressed) {
+      if (input.up_pressed) {
          intention.y -= intention_span;
          something_pressed = true;
       }
-      if (s_pressed) {
+      if (input.down_pressed) {
          intention.y += intention_span;
          something_pressed = true;
       }
@@ -130,17 +49,17 @@ namespace {
 
 
    [[nodiscard]] auto get_player_target(
-      const std::optional<moo::ScreenCoord>& keyboard_intention,
-      const moo::ScreenCoord& mouse_target,
+      const moo::Input& input,
       const moo::ScreenCoord& player_pos
    ) -> moo::ScreenCoord
    {
+      const std::optional<moo::ScreenCoord> keyboard_intention = get_keyboard_intention(input);
       if (keyboard_intention.has_value())
          return player_pos + keyboard_intention.value();
-      else if (!moo::get_config().enable_mouse)
+      else if (!moo::get_config().enable_mouse || !input.mouse_pos.has_value())
          return player_pos;
       else
-         return mouse_target;
+         return input.mouse_pos.value();
    }
 
 
@@ -161,20 +80,17 @@ namespace {
 
 
    auto draw_to_bg(
-      moo::BgBuffer& target,
+      moo::BlendingArea& target,
       moo::LineCoordIt image_it,
       const moo::LineCoord& image_top_left,
       const double alpha
    ) -> void
    {
       ZoneScoped;
+      const unsigned char alpha_byte = moo::get_alpha(alpha);
       for (; image_it.is_valid(); ++image_it) {
-         const moo::LineCoord bg_pos = image_top_left + *image_it;
-         if (!is_on_screen(bg_pos) || !image_it.get_image_pixel().is_visible())
-            continue;
-         const size_t index = to_screen_index(bg_pos);
-         target[index].m_rgb = image_it.get_image_pixel();
-         target[index].m_alpha += alpha;
+         if (image_it.get_image_pixel().is_visible())
+            target.add(image_top_left + *image_it, image_it.get_image_pixel(), alpha_byte);
       }
    }
 
@@ -222,29 +138,93 @@ namespace {
    }
 
 
+   // Small enough that a default screen has bands for several threads, large enough that sprites mostly
+   // touch only one or two of them
+   constexpr int band_rows = 4;
+
+
+   // The layers of the far background
+   constexpr size_t sky_layer = 0;
+   constexpr size_t back_mountain_layer = 1;
+   constexpr size_t middle_mountain_layer = 2;
+
+   // The far mountains move slowly, so they look the same for several frames even with this many steps
+   constexpr int far_mountain_offset_steps = 8;
+
+   // Even huge terminals show something recognizable at this scale
+   constexpr int max_resolution_scale = 4;
+
+
+   [[nodiscard]] auto get_band_count() -> int {
+      return (moo::static_rows + band_rows - 1) / band_rows;
+   }
+
+
+   [[nodiscard]] auto get_band(const int index) -> moo::Band {
+      const int begin_i = index * band_rows;
+      return { index, begin_i, std::min(begin_i + band_rows, moo::static_rows) };
+   }
+
+
+   // The screen rows of a band that are also in [begin_i, end_i)
+   [[nodiscard]] auto get_band_rows(
+      const moo::Band& band,
+      const int begin_i,
+      const int end_i
+   ) -> std::pair<int, int>
+   {
+      return { std::max(band.begin_i, begin_i), std::min(band.end_i, end_i) };
+   }
+
+
+   // Headless frames advance by this much, whatever time they take
+   constexpr double headless_dt = 1.0 / 60.0;
+
+
    [[nodiscard]] auto get_ufo() -> moo::Ufo {
       const moo::ScreenCoord initial_pos{ 0.8, 0.3 };
       return moo::Ufo(initial_pos, 0.0);
    }
 
+
+   // Empty for headless games
+   [[nodiscard]] auto get_terminal(const moo::HeadlessTarget* headless_target) -> std::optional<moo::Terminal> {
+      if (headless_target != nullptr)
+         return std::nullopt;
+      return std::optional<moo::Terminal>(std::in_place);
+   }
+
+
+   [[nodiscard]] auto get_frame_target(
+      std::optional<moo::Terminal>& terminal,
+      moo::HeadlessTarget* headless_target
+   ) -> moo::FrameTarget
+   {
+      if (headless_target != nullptr)
+         return headless_target;
+      return &terminal.value();
+   }
+
 } // namespace {}
 
 
-moo::game::game()
-   : m_initial_console_state(get_console_state())
-   , m_window_rect(get_window_rect())
-   , m_output_handle(GetStdHandle(STD_OUTPUT_HANDLE))
-   , m_input_handle(GetStdHandle(STD_INPUT_HANDLE))
+/// <summary>With a headless target, the frames go there instead of the console</summary>
+moo::game::game(HeadlessTarget* headless_target)
+   : m_terminal(get_terminal(headless_target))
+   , m_frame_writer(get_frame_target(m_terminal, headless_target))
    , m_grass_noise(get_ground_row_height(), static_columns)
+   , m_sky_and_ground(m_grass_noise)
    , m_screen_text(get_char_count(), { '\0', std::nullopt })
    , m_player_animation(load_animation("gfx/player.png"))
    , m_player_anim_frame(2, 0.08, 0.0)
    , m_ufo_animation(load_ufo_animation("gfx/ufo.png"))
    , m_pixel_buffer(get_pixel_count(), RGB{})
+   , m_resolution_scaler(get_config().target_fps, max_resolution_scale)
    , m_t_last(std::chrono::system_clock::now())
    , m_front_mountain(0, RGB{62, 85, 103})
-   , m_middle_mountain(2, RGB{ 69, 104, 126 })
-   , m_back_mountain(4, RGB{ 104, 145, 165 })
+   , m_middle_mountain(2, RGB{ 69, 104, 126 }, far_mountain_offset_steps)
+   , m_back_mountain(4, RGB{ 104, 145, 165 }, far_mountain_offset_steps)
+   , m_far_layers({ 0, m_back_mountain.get_top_row(), m_middle_mountain.get_top_row() })
    , m_strategy_change_cooldown(get_config().new_strategy_interval)
 {
    for (Animation& animation : load_animations(true, "gfx/cow_brown.png", "gfx/cow_white_brown.png", "gfx/cow_white_black.png")) {
@@ -256,13 +236,8 @@ moo::game::game()
       m_registry.emplace<CloudImage>(entity, std::move(cloud_image));
    }
 
-   m_output_string.reserve(100000);
-
    add_clouds(get_config().cloud_count, false);
-
-   disable_selection();
-   disable_console_cursor();
-   enable_vt_mode(m_output_handle);
+   m_bg_damage.add_all();
 }
 
 
@@ -287,17 +262,14 @@ void moo::game::early_test(const bool use_colors) {
          });
    }
 
-   std::wstring str, fps_str;
-   str.reserve(100000);
+   ByteBuffer str(get_max_frame_size());
+   std::string fps_str;
    while (true) {
-      {
-         ZoneScopedNC("SetConsoleCursorPosition()", 0x0000ff);
-         set_cursor_top_left(m_output_handle);
-      }
       str.clear();
+      str += "\x1b[H";
       {
          ZoneScopedN("fmt()");
-         fps_str = fmt::format(L"FPS: {}    ", m_fps_counter.m_current_fps);
+         fps_str = fmt::format("FPS: {}    ", m_fps_counter.m_current_fps);
       }
       {
          ZoneScopedN("string building");
@@ -311,11 +283,11 @@ void moo::game::early_test(const bool use_colors) {
             if (it->i == 0 && it->j < fps_str.length())
                str += fps_str[it->j];
             else
-               str += std::to_wstring(rand() % 10);
+               str += static_cast<char>('0' + rand() % 10);
          }
       }
       
-      write(m_output_handle, str);
+      m_terminal->write(str.get_view());
       const auto now = std::chrono::system_clock::now();
       m_fps_counter.step(now);
       FrameMark;
@@ -327,13 +299,15 @@ auto moo::game::run() -> void{
    while (true) {
       const ContinueWish continue_return = game_loop();
       if (continue_return == ContinueWish::Exit) {
-         set_console_state(m_initial_console_state);
-         clear_screen();
+         m_frame_writer.stop();
+         m_terminal->restore();
+         m_terminal->clear_screen();
          return;
       }
       else if (continue_return == ContinueWish::GameOver) {
-         set_console_state(m_initial_console_state);
-         clear_screen();
+         m_frame_writer.stop();
+         m_terminal->restore();
+         m_terminal->clear_screen();
          printf("Game Over at level: %i\n", m_level);
          return;
       }
@@ -341,28 +315,54 @@ auto moo::game::run() -> void{
 }
 
 
+// Starts right into the game, like after pressing space on the logo. The frames are reproducible: they
+// get no input and a fixed time step, and the resolution stays full. The seed is up to the caller, it's
+// used during construction already.
+auto moo::game::run_headless(const int frame_count) -> void{
+   m_draw_logo = false;
+   m_draw_fg = true;
+   m_bg_fade = 0.0;
+   for (int i = 0; i < frame_count; ++i) {
+      if (step(Input{}, headless_dt) != ContinueWish::Continue)
+         return;
+   }
+}
+
+
 auto moo::game::game_loop() -> ContinueWish {
-   if (is_esc_pressed())
+   const Input input = m_terminal->read_input();
+   const auto now = std::chrono::system_clock::now();
+   const Seconds dt = std::chrono::duration<double>(now - m_t_last).count();
+   m_t_last = now;
+   // The scale only makes a difference to how long writing frames takes, so that's what it follows. The
+   // game's own frame rate doesn't depend on the terminal, frames are dropped instead.
+   const double write_fps = m_frame_writer.get_write_fps();
+   if (m_fps_counter.step(now) && get_config().dynamic_resolution && write_fps > 0.0)
+      m_resolution_scaler.update(write_fps);
+   return step(input, dt);
+}
+
+
+auto moo::game::step(
+   const Input& input,
+   const Seconds dt
+) -> ContinueWish
+{
+   if (input.esc_pressed)
       return ContinueWish::Exit;
-   if (m_draw_logo && GetKeyState(VK_SPACE) < 0) {
+   if (m_draw_logo && input.space_pressed) {
       m_draw_logo = false;
       m_draw_fg = true;
       m_bg_fade = 0.0;
       m_ufo_spawn_timer.restart();
    }
-   refresh_window_rect();
-   refresh_mouse_pos();
-   handle_mouse_click();
-
-   const auto now = std::chrono::system_clock::now();
-   const Seconds dt = std::chrono::duration_cast<std::chrono::milliseconds>(now - m_t_last).count() / 1000.0;
-   m_fps_counter.step(now);
+   handle_mouse_click(input);
 
    const double day_len_in_s = get_config().day_length;
    m_time += dt / day_len_in_s;
 
    clear_buffers();
-   const auto logic_result = do_logic(dt);
+   const auto logic_result = do_logic(input, dt);
    if (logic_result.has_value())
       return logic_result.value();
    do_drawing(m_draw_fg);
@@ -370,58 +370,108 @@ auto moo::game::game_loop() -> ContinueWish {
    if(m_draw_logo)
       write_logo();
    combine_buffers(m_draw_fg);
-   set_cursor_top_left(m_output_handle);
-   write(m_output_handle, m_output_string);
-   
-   m_t_last = now;
+   m_frame_writer.submit();
+
    FrameMark;
    return ContinueWish::Continue;
 }
 
 
-void moo::game::write_one_block(
+auto moo::game::get_block_cell(
    const BlockChar& fg_block_char,
    const RGB row_bg_color,
    const bool draw_fg
-) {
-   if (!draw_fg) {
-      m_painter.paint(RGB{}, row_bg_color, m_output_string);
-      m_output_string += L" ";
-      return;
-   }
-   const std::optional<TwoColors> two_colors = fg_block_char.get_two_colors();
-   if (fg_block_char.is_all_visible() && two_colors.has_value()) {
-      // no BG visible and FG contains 2+ different colors. Can use two FG colors in this cell!
-      m_painter.paint(two_colors.value().first, two_colors.value().second, m_output_string);
-      const wchar_t block_char_char = get_block_glyph(fg_block_char, [&](const RGB& color) {return color == two_colors.value().first; });
-      m_output_string += block_char_char;
-   }
-   else {
-      const CharAndColor char_and_col = get_cell_char(fg_block_char);
-      if (char_and_col.color.is_visible())
-         m_painter.paint(char_and_col.color, row_bg_color, m_output_string);
-      m_output_string += char_and_col.ch;
-   }
+) const -> Cell
+{
+   if (!draw_fg)
+      return { L' ', RGB{}, row_bg_color };
+   return get_quadrant_cell(fg_block_char, row_bg_color);
 }
 
 
+// With a resolution scale above 1, every block of scale x scale cells shows its top left cell, or the first
+// one with a visible foreground if that has none: small things like bullets would vanish otherwise. Text is
+// always drawn at full resolution, so that it stays readable.
 void moo::game::combine_buffers(const bool draw_fg){
    ZoneScoped;
-   m_output_string.clear();
-   m_painter.reset_paint_count();
+   const ColorMode color_mode = get_config().color_mode;
+   const CellMode cell_mode = get_config().cell_mode;
+   const int scale = m_resolution_scaler.get_scale();
+   CellBuffer& cells = m_frame_writer.get_back_buffer();
+   fade_bg();
+
+   // Quantizing here already means cells that end up with the same palette color count as unchanged
+   const auto get_quantized = [&](Cell cell) {
+      if (color_mode != ColorMode::TrueColor) {
+         cell.fg = get_quantized_color(cell.fg, color_mode);
+         cell.bg = get_quantized_color(cell.bg, color_mode);
+      }
+      return cell;
+   };
+
+   const auto get_drawn_cell = [&](const LineCoord& pos) -> Cell {
+      const RGB bg_color = m_faded_bg_buffer[to_screen_index(pos)];
+      if (!m_pixel_damage.is_damaged(pos)) {
+         // Nothing was drawn there, so there's no foreground
+         return { L' ', RGB{}, bg_color };
+      }
+      if (cell_mode == CellMode::HalfBlocks)
+         return draw_fg ? get_half_block_cell(get_half_block_from_fg(pos), bg_color) : Cell{ L' ', RGB{}, bg_color };
+      return get_block_cell(get_block_char_from_fg(pos), bg_color, draw_fg);
+   };
 
-   for (LineCoordIt it = get_screen_it(); it.is_valid(); ++it) {
-      const RGB bg_color = get_color_mix(m_bg_buffer[to_screen_index(*it)], RGB{0, 0, 0}, m_bg_fade);
-      m_painter.paint_layer(bg_color, Layer::Back, m_output_string);
+   for (int i = 0; i < static_rows; i += scale) {
+      const int block_end_i = std::min(i + scale, static_rows);
+      for (int j = 0; j < static_columns; j += scale) {
+         const int block_end_j = std::min(j + scale, static_columns);
+         Cell cell = get_drawn_cell(LineCoord{ i, j });
+         for (int block_i = i; block_i < block_end_i && !cell.has_fg(); ++block_i) {
+            for (int block_j = (block_i == i) ? j + 1 : j; block_j < block_end_j && !cell.has_fg(); ++block_j) {
+               const LineCoord pos{ block_i, block_j };
+               if (!m_pixel_damage.is_damaged(pos))
+                  continue;
+               if (const Cell drawn = get_drawn_cell(pos); drawn.has_fg())
+                  cell = drawn;
+            }
+         }
+         cell = get_quantized(cell);
+         for (int block_i = i; block_i < block_end_i; ++block_i) {
+            const auto row_begin = cells.m_colors.begin() + to_screen_index(LineCoord{ block_i, 0 });
+            std::fill(row_begin + j, row_begin + block_end_j, cell);
+         }
+      }
+   }
 
-      const OverlayCharacter& overlay_char = m_screen_text[to_screen_index(*it)];
-      if (const char screen_char = overlay_char.ch; screen_char != '\0') {
+   for (int i = 0; i < static_rows; ++i) {
+      const ColumnRange text_range = m_text_damage.get_damage(i);
+      for (int j = text_range.begin_j; j < text_range.end_j; ++j) {
+         const size_t index = to_screen_index(LineCoord{ i, j });
+         const OverlayCharacter& overlay_char = m_screen_text[index];
+         if (overlay_char.ch == '\0')
+            continue;
          const RGB text_color = overlay_char.color.value_or(RGB{ 255, 180, 0 });
-         m_painter.paint_layer(text_color, Layer::Front, m_output_string);
-         m_output_string += screen_char;
-         continue;
+         cells[index] = get_quantized({ static_cast<wchar_t>(overlay_char.ch), text_color, m_faded_bg_buffer[index] });
       }
-      write_one_block(get_block_char_from_fg(*it), bg_color, draw_fg);
+   }
+}
+
+
+// Only where the background changed, unless the fade did
+auto moo::game::fade_bg() -> void{
+   ZoneScoped;
+   const int factor = get_blend_factor(m_bg_fade);
+   if (m_faded_bg_fade != m_bg_fade) {
+      blend_to_color(m_bg_buffer.m_colors, RGB{ 0, 0, 0 }, factor, m_faded_bg_buffer.m_colors);
+      m_faded_bg_fade = m_bg_fade;
+      return;
+   }
+   for (int i = 0; i < static_rows; ++i) {
+      const ColumnRange range = m_bg_damage.get_damage(i);
+      if (range.is_empty())
+         continue;
+      const size_t begin = to_screen_index(LineCoord{ i, range.begin_j });
+      const size_t size = static_cast<size_t>(range.end_j - range.begin_j);
+      blend_to_color(std::span<const RGB>(&m_bg_buffer[begin], size), RGB{ 0, 0, 0 }, factor, std::span<RGB>(&m_faded_bg_buffer[begin], size));
    }
 }
 
@@ -437,134 +487,182 @@ auto moo::game::get_block_char_from_fg(const LineCoord& line_coord) const -> Blo
 }
 
 
-auto moo::game::get_bg_color(const LineCoord& coord) const -> RGB{
-   const int sky_height = get_sky_row_height();
-   const int ground_height = get_ground_row_height();
-   const bool is_sky = coord.i < sky_height;
-   if (is_sky) {
-      const double sky_fraction = 1.0 * coord.i / sky_height;
-      return get_sky_color(sky_fraction);
-   }
-   else {
-      const int lane = coord.i - sky_height;
-      const double ground_fraction = 1.0 * lane / ground_height;
-      const int anim_offset = static_cast<int>(static_columns * m_grass_noise.m_anim_offsets[lane]);
-      const size_t noise_row_index = (coord.j + anim_offset) % (2 * static_columns);
-      const int color_offset = m_grass_noise.m_row_noise[lane][noise_row_index];
-      const RGB base_color = get_ground_color(ground_fraction);
-      return get_offsetted_color(base_color, color_offset);
-   }
+// Only the left pixels, unless they're transparent
+auto moo::game::get_half_block_from_fg(const LineCoord& line_coord) const -> HalfBlock{
+   const PixelCoord tl = to_pixel_coord_tl(line_coord);
+   const RGB* top_row = &m_pixel_buffer[to_screen_index(tl)];
+   const RGB* bottom_row = &m_pixel_buffer[to_screen_index(tl + PixelCoord{ 1, 0 })];
+   return {
+      get_half_block_pixel(top_row[0], top_row[1]),
+      get_half_block_pixel(bottom_row[0], bottom_row[1])
+   };
 }
 
 
+// The offsets wrap around with the rings, which are two screen widths long
 auto moo::game::iterate_grass_movement(const Seconds dt) -> void{
-   const int sky_height = get_sky_row_height();
-   for (int i = get_sky_row_height(); i < static_rows; ++i) {
-      const int lane = i - sky_height;
-      m_grass_noise.m_anim_offsets[lane] += get_lane_speed(lane, dt);
+   for (int lane = 0; lane < get_ground_row_height(); ++lane) {
+      double& anim_offset = m_grass_noise.m_anim_offsets[lane];
+      anim_offset = sane_fmod(anim_offset + get_lane_speed(lane, dt), 2.0);
+      m_grass_noise.m_ring_offsets[lane] = static_cast<int>(static_columns * anim_offset) % m_grass_noise.m_ring_size;
    }
 }
 
 
-auto moo::game::draw_sky_and_ground() -> void{
+// Only the layers that changed and the ones above them
+auto moo::game::draw_far_layers(const Band& band) -> void{
    ZoneScoped;
-   for(LineCoordIt it = get_screen_it(); it.is_valid(); ++it)
-      m_bg_buffer[it.to_range_index()] = get_bg_color(*it);
+   const auto [begin_i, end_i] = get_band_rows(band, 0, get_sky_row_height());
+   for (size_t layer_index = m_far_layers.get_first_stale(); layer_index < m_far_layers.m_layers.size(); ++layer_index) {
+      BgColorBuffer& target = m_far_layers.start_redraw(layer_index, begin_i, end_i);
+      if (layer_index == sky_layer) {
+         for (int i = begin_i; i < end_i; ++i) {
+            RGB* row = &target[to_screen_index(LineCoord{ i, 0 })];
+            std::fill(row, row + static_columns, m_sky_and_ground.m_sky_colors[i]);
+         }
+      }
+      else {
+         const MountainRange& mountains = (layer_index == back_mountain_layer) ? m_back_mountain : m_middle_mountain;
+         mountains.draw(target, begin_i, end_i);
+      }
+   }
 }
 
 
-auto moo::game::draw_mountain(
-   const BgColorBuffer& mountain, 
-   BgBuffer& target,
-   const double alpha
-) -> void
-{
-   for (int i = 0; i < static_rows; ++i) {
-      for (int j = 0; j < static_columns; ++j) {
-         const int index = i * static_columns + j;
-         if(mountain[index].is_invisible())
-            continue;
-         target[index].m_rgb = mountain[index];
-         target[index].m_alpha += alpha;
-      }
+// The far background mostly stays the same, then only what was drawn over it last frame needs to be
+// restored. The grass moves everywhere.
+auto moo::game::draw_sky_and_ground(const Band& band) -> void{
+   ZoneScoped;
+   const int sky_height = get_sky_row_height();
+   const auto [sky_begin_i, sky_end_i] = get_band_rows(band, 0, sky_height);
+   const BgColorBuffer& far_background = m_far_layers.get_top();
+   const int redrawn_begin_i = m_far_layers.get_redrawn_begin_i();
+   for (int i = sky_begin_i; i < sky_end_i; ++i) {
+      const ColumnRange range = (i >= redrawn_begin_i) ? ColumnRange{ 0, static_columns } : m_bg_damage.get_previous(i);
+      if (range.is_empty())
+         continue;
+      const size_t begin = to_screen_index(LineCoord{ i, range.begin_j });
+      const size_t end = to_screen_index(LineCoord{ i, range.end_j });
+      std::copy(far_background.m_colors.begin() + begin, far_background.m_colors.begin() + end, m_bg_buffer.m_colors.begin() + begin);
    }
-}
+   m_bg_damage.add_rows(std::max(sky_begin_i, redrawn_begin_i), sky_end_i);
 
+   // Every ground row is the end of its ring followed by its start
+   const int ring_size = m_grass_noise.m_ring_size;
+   const auto [ground_begin_i, ground_end_i] = get_band_rows(band, sky_height, static_rows);
+   for (int i = ground_begin_i; i < ground_end_i; ++i) {
+      const int lane = i - sky_height;
+      const int ring_offset = m_grass_noise.m_ring_offsets[lane];
+      const RGB* ring = &m_sky_and_ground.m_ground_rings[static_cast<size_t>(lane) * ring_size];
+      RGB* row = &m_bg_buffer[to_screen_index(LineCoord{ i, 0 })];
+      const int end_length = std::min(static_columns, ring_size - ring_offset);
+      std::copy(ring + ring_offset, ring + ring_offset + end_length, row);
+      std::copy(ring, ring + (static_columns - end_length), row + end_length);
+   }
+   m_bg_damage.add_rows(ground_begin_i, ground_end_i);
+}
 
-auto moo::game::draw_mountain_range(const MountainRange& mountains) -> void{
-   m_blending_buffer.clear();
-   const double fmod = sane_fmod(mountains.m_position * static_columns, 1.0);
-   draw_mountain(mountains.m_next_mountain, m_blending_buffer, 1.0 - fmod);
-   draw_mountain(mountains.m_mountain, m_blending_buffer, fmod);
 
-   draw_buffer_to_bg(m_blending_buffer);
+auto moo::game::draw_mountain_range(
+   const MountainRange& mountains,
+   const Band& band
+) -> void
+{
+   mountains.draw(m_bg_buffer, band.begin_i, band.end_i);
+   const auto [begin_i, end_i] = get_band_rows(band, mountains.get_top_row(), get_sky_row_height());
+   m_bg_damage.add_rows(begin_i, end_i);
 }
 
 
-auto moo::game::draw_mountains() -> void{
+// Every band blends its part of the clouds in its own area
+auto moo::game::draw_clouds(const Band& band) -> void{
    ZoneScoped;
-   draw_mountain_range(m_back_mountain);
-   draw_mountain_range(m_middle_mountain);
-   draw_mountain_range(m_front_mountain);
+   BlendingArea& area = m_cloud_areas[band.index];
+   for (const CloudDraw& cloud : m_draw_list.m_clouds) {
+      const LineCoord top_left_dash = cloud.top_left + LineCoord{ 0, -1 };
+      const LineCoord bottom_right = cloud.top_left + cloud.image.get_dim<LineCoord>();
+      const auto [begin_i, end_i] = get_band_rows(band, top_left_dash.i, bottom_right.i);
+      if (begin_i >= end_i)
+         continue;
+
+      // The cloud and its copy one column to the left
+      area.reset(LineCoord{ begin_i, top_left_dash.j }, LineCoord{ end_i, bottom_right.j });
+      draw_to_bg(area, LineCoordIt(cloud.image), top_left_dash, 1.0 - cloud.fmod);
+      draw_to_bg(area, LineCoordIt(cloud.image), cloud.top_left, cloud.fmod);
+      area.blend_into(m_bg_buffer);
+      m_bg_damage.add(area.m_top_left, area.m_bottom_right);
+   }
 }
 
 
-auto moo::game::draw_background() -> void {
+auto moo::game::draw_background(const Band& band) -> void {
    ZoneScoped;
-   draw_sky_and_ground();
-   draw_mountains();
-   m_registry.view<IsCloud, CloudImageRef, ScreenCoord>().each([&](
-      CloudImageRef image_ref, const ScreenCoord& pos
-      ) {
-         const ImageWrapper& cloud_image = m_registry.get<CloudImage>(image_ref);
-         const double fmod = sane_fmod(pos.x * static_columns, 1.0);
-         const LineCoord top_left = get_top_left(to_line_coord(pos), cloud_image.get_dim<LineCoord>());
-         const LineCoord top_left_dash = top_left + LineCoord{0, -1};
+   draw_far_layers(band);
+   draw_sky_and_ground(band);
+   draw_mountain_range(m_front_mountain, band);
+   draw_clouds(band);
+}
 
-         m_blending_buffer.clear();
-         draw_to_bg(m_blending_buffer, LineCoordIt(cloud_image), top_left_dash, 1.0 - fmod);
-         draw_to_bg(m_blending_buffer, LineCoordIt(cloud_image), top_left, fmod);
-         draw_buffer_to_bg(m_blending_buffer);
-      }
-   );
+
+auto moo::game::write_pixel(const PixelCoord& pos, const RGB& color) -> void{
+   m_pixel_buffer[to_screen_index(pos)] = color;
+   m_pixel_damage.add(to_line_coord(pos));
 }
 
 
-auto moo::game::draw_puff(const ScreenCoord& puff_screen_pos, const RGB& color) -> void{
+auto moo::game::add_puff(const ScreenCoord& puff_screen_pos, const RGB& color) -> void{
    if (!puff_screen_pos.is_on_screen())
       return;
-   const PixelCoord puff_pos = to_pixel_coord(puff_screen_pos);
-   const size_t index = to_screen_index(get_screen_clamped(puff_pos));
-   const size_t bg_index = (puff_pos.i / 2) * static_columns + puff_pos.j / 2;
-   m_pixel_buffer[index] = get_color_mix(m_bg_buffer[bg_index], color, 0.7);
+   const PixelCoord puff_pos = get_screen_clamped(to_pixel_coord(puff_screen_pos));
+   m_draw_list.add(PuffDraw{ puff_pos, color }, puff_pos.i, puff_pos.i + 1);
 }
 
-auto moo::game::draw_trail(const Trail& trail) -> void{
+
+auto moo::game::add_trail(const Trail& trail) -> void{
    for (const TrailPuff& puff : trail.m_smoke_puffs) {
-      draw_puff(puff.pos, puff.color);
+      add_puff(puff.pos, puff.color);
    }
 }
 
 
-auto moo::game::draw_bullet(const Bullet& bullet) -> void{
+// Both shapes are three pixel rows high
+auto moo::game::add_bullet(const Bullet& bullet) -> void{
    const ScreenCoord bullet_pos = bullet.m_pos;
-   if (bullet_pos.is_on_screen()) {
-      constexpr RGB bullet_color = {255, 0, 0};
-      const PixelCoord bullet_pixel_pos = to_pixel_coord(bullet_pos);
+   if (!bullet_pos.is_on_screen())
+      return;
+   const PixelCoord bullet_pixel_pos = to_pixel_coord(bullet_pos);
+   const int begin_i = get_screen_clamped(bullet_pixel_pos + PixelCoord{ -1, 0 }).i;
+   const int end_i = get_screen_clamped(bullet_pixel_pos + PixelCoord{ 1, 0 }).i + 1;
+   m_draw_list.add(BulletDraw{ bullet_pixel_pos, bullet.m_style }, begin_i, end_i);
+}
 
-      if (bullet.m_style == BulletStyle::Rocket) {
-         for (const PixelCoord& coord : get_player_bullet_shape())
-            m_pixel_buffer[to_screen_index(get_screen_clamped(bullet_pixel_pos + coord))] = bullet_color;
-      }
-      else {
-         for (const PixelCoord& coord : get_alien_bullet_shape())
-            m_pixel_buffer[to_screen_index(get_screen_clamped(bullet_pixel_pos + coord))] = bullet_color;
+
+// Mixed with the background below, which the band has already drawn
+auto moo::game::draw_puff(const PuffDraw& puff, const Band& band) -> void{
+   if (!band.contains_pixel_row(puff.pos.i))
+      return;
+   const size_t bg_index = to_screen_index(to_line_coord(puff.pos));
+   write_pixel(puff.pos, get_fixed_color_mix(m_bg_buffer[bg_index], puff.color, get_blend_factor(0.7)));
+}
+
+
+auto moo::game::draw_bullet(const BulletDraw& bullet, const Band& band) -> void{
+   constexpr RGB bullet_color = {255, 0, 0};
+   const auto draw_shape = [&](const auto& shape) {
+      for (const PixelCoord& coord : shape) {
+         const PixelCoord pos = get_screen_clamped(bullet.pos + coord);
+         if (band.contains_pixel_row(pos.i))
+            write_pixel(pos, bullet_color);
       }
-   }
+   };
+   if (bullet.style == BulletStyle::Rocket)
+      draw_shape(get_player_bullet_shape());
+   else
+      draw_shape(get_alien_bullet_shape());
 }
 
 
-auto moo::game::draw_beam(const Ufo& ufo) -> void{
+auto moo::game::add_beam(const Ufo& ufo) -> void{
    if (!ufo.m_beaming)
       return;
    const auto cow_entity = std::get<Abduct>(ufo.m_strategy).m_target_cow;
@@ -580,15 +678,26 @@ auto moo::game::draw_beam(const Ufo& ufo) -> void{
    for (int i = 0; i < beam_pixel_height; ++i) {
       const double y_ratio = 1.0 * i / beam_pixel_height;
       const int j_offset = (start_beam_width - beam_width) / 2;
-      for (int j = 0; j < beam_width; ++j) {
-         const LineCoord pos{ i, j + j_offset };
-         const LineCoord line_pos = to_line_coord(ufo.m_pos) + pos + LineCoord{ m_ufo_animation.m_height / 2 - safety_i, -start_beam_width / 2 };
-         if (!is_on_screen(line_pos))
-            continue;;
-         const size_t bg_index = to_screen_index(line_pos);
-         m_bg_buffer[bg_index] = get_color_mix(m_bg_buffer[bg_index], { 255, 255, 255 }, get_beam_intensity(m_time, y_ratio));
-      }
+      const LineCoord row_start = to_line_coord(ufo.m_pos) + LineCoord{ i, j_offset } + LineCoord{ m_ufo_animation.m_height / 2 - safety_i, -start_beam_width / 2 };
+      const int begin_j = std::max(row_start.j, 0);
+      const int end_j = std::min(row_start.j + beam_width, static_columns);
       beam_width += 2;
+      if (row_start.i < 0 || row_start.i >= static_rows || begin_j >= end_j)
+         continue;
+
+      // Every row of the beam is one span with one intensity
+      m_draw_list.m_beam_rows.push_back({ row_start.i, ColumnRange{ begin_j, end_j }, get_blend_factor(get_beam_intensity(m_time, y_ratio)) });
+   }
+}
+
+
+auto moo::game::draw_beam(const Band& band) -> void{
+   for (const BeamRow& beam_row : m_draw_list.m_beam_rows) {
+      if (beam_row.i < band.begin_i || beam_row.i >= band.end_i)
+         continue;
+      const std::span<RGB> row(&m_bg_buffer[to_screen_index(LineCoord{ beam_row.i, beam_row.range.begin_j })], static_cast<size_t>(beam_row.range.end_j - beam_row.range.begin_j));
+      blend_to_color(row, { 255, 255, 255 }, beam_row.factor, row);
+      m_bg_damage.add(LineCoord{ beam_row.i, beam_row.range.begin_j }, LineCoord{ beam_row.i + 1, beam_row.range.end_j });
    }
 }
 
@@ -631,12 +740,16 @@ auto moo::game::do_cloud_logic(const Seconds dt) -> void{
 }
 
 
-auto moo::game::do_logic(const Seconds dt) -> std::optional<ContinueWish> {
+auto moo::game::do_logic(
+   const Input& input,
+   const Seconds dt
+) -> std::optional<ContinueWish>
+{
    run_ufo_spawning_logic(dt);
    run_ufo_strategy_logic(dt);
 
    spawn_new_cows(m_registry, m_draw_logo);
-   m_player.move_towards(get_player_target(get_keyboard_intention(), m_mouse_pos, m_player.m_pos), dt);
+   m_player.move_towards(get_player_target(input, m_player.m_pos), dt);
    iterate_grass_movement(dt);
    do_cow_logic(dt);
    do_cloud_logic(dt);
@@ -707,36 +820,84 @@ auto moo::game::do_logic(const Seconds dt) -> std::optional<ContinueWish> {
 }
 
 
-auto moo::game::do_drawing(const bool draw_fg) -> void{
-   draw_background();
+// Everything that touches the registry or the sprite cache, in drawing order
+auto moo::game::gather_drawing(const bool draw_fg) -> void{
+   ZoneScoped;
+   m_bg_damage.next_frame();
+   m_sprite_cache.trim();
+   m_draw_list.clear(get_band_count());
+   m_far_layers.set_version(back_mountain_layer, m_back_mountain.get_version());
+   m_far_layers.set_version(middle_mountain_layer, m_middle_mountain.get_version());
+
+   m_registry.view<IsCloud, CloudImageRef, ScreenCoord>().each([&](
+      CloudImageRef image_ref, const ScreenCoord& pos
+      ) {
+         const ImageWrapper cloud_image = m_registry.get<CloudImage>(image_ref);
+         const LineCoord top_left = get_top_left(to_line_coord(pos), cloud_image.get_dim<LineCoord>());
+         m_draw_list.m_clouds.push_back({ cloud_image, top_left, sane_fmod(pos.x * static_columns, 1.0) });
+      }
+   );
 
    if (draw_fg && m_ufo.has_value()) {
-      draw_beam(m_ufo.value());
-      draw_shadow(m_player.m_pos, m_player_animation.m_width / 2, 1);
+      add_beam(m_ufo.value());
+      m_draw_list.m_draw_shadow = true;
    }
-   draw_cows();
+   add_cows();
    m_registry.view<Trail>().each([&](Trail& trail) {
-      draw_trail(trail);
+      add_trail(trail);
       });
    m_registry.view<IsPuff, ScreenCoord, RGB>().each([&](const ScreenCoord& pos, const RGB& color) {
-      draw_puff(pos, color);
+      add_puff(pos, color);
       });
    m_registry.view<Bullet>().each([&](Bullet& bullet) {
-      draw_bullet(bullet);
+      add_bullet(bullet);
       });
 
    if(m_ufo.has_value()){
       std::optional<RGB> override_color;
       if (m_ufo->is_invul())
          override_color = { 255, 255, 255 };
-      write_image_at_pos(m_ufo_animation[m_ufo->m_animation_frame.get_index()], m_ufo->m_pos, WriteAlignment::Center, 1.0, override_color, 0.0);
+      add_sprite_draw(get_sprite_draw(m_ufo_animation.m_sprites[m_ufo->m_animation_frame.get_index()], m_ufo->m_pos, WriteAlignment::Center, 1.0, override_color, 0.0));
    }
 
 
    std::optional<RGB> player_override_color;
    if (m_player.is_invul())
       player_override_color = { 255, 255, 255 };
-   write_image_at_pos(m_player_animation[m_player_anim_frame.get_index()], m_player.m_pos, WriteAlignment::Center, 1.0, player_override_color, 0.0);
+   add_sprite_draw(get_sprite_draw(m_player_animation.m_sprites[m_player_anim_frame.get_index()], m_player.m_pos, WriteAlignment::Center, 1.0, player_override_color, 0.0));
+}
+
+
+// Runs on a pool thread. Only writes the rows of its band, to the buffers and to the damage trackers.
+auto moo::game::draw_band(const Band& band) -> void{
+   ZoneScoped;
+   draw_background(band);
+   draw_beam(band);
+   if (m_draw_list.m_draw_shadow)
+      draw_shadow(band, m_player.m_pos, m_player_animation.m_width / 2, 1);
+
+   for (const int draw_index : m_draw_list.m_band_draws[band.index]) {
+      const PixelDraw& draw = m_draw_list.m_pixel_draws[draw_index];
+      if (const auto* sprite_draw = std::get_if<SpriteDraw>(&draw))
+         draw_sprite(*sprite_draw, band);
+      else if (const auto* puff_draw = std::get_if<PuffDraw>(&draw))
+         draw_puff(*puff_draw, band);
+      else
+         draw_bullet(std::get<BulletDraw>(draw), band);
+   }
+}
+
+
+// The screen is drawn in bands of rows, in parallel. Drawing order only matters within a cell, and every
+// cell is in one band.
+auto moo::game::do_drawing(const bool draw_fg) -> void{
+   gather_drawing(draw_fg);
+   const int band_count = get_band_count();
+   m_cloud_areas.resize(band_count);
+   m_thread_pool.run(band_count, [&](const int band_index) {
+      draw_band(get_band(band_index));
+   });
+   m_far_layers.finish_frame();
 
    if(draw_fg)
       draw_gui();
@@ -746,9 +907,11 @@ auto moo::game::do_drawing(const bool draw_fg) -> void{
 auto moo::game::draw_gui() -> void{
    ZoneScopedN("Drawing GUI");
    std::string gui_text = fmt::format(
-      "FPS: {:.1f}, color changes: {}, HP: {:.1f}, level: {}",
+      "FPS: {:.1f}, resolution: 1/{}, color changes: {}, bytes saved: {}, HP: {:.1f}, level: {}",
       m_fps_counter.m_current_fps,
-      m_painter.get_paint_count(),
+      m_resolution_scaler.get_scale(),
+      m_frame_writer.get_paint_count(),
+      m_frame_writer.get_bytes_saved(),
       m_player.m_hitpoints,
       m_level
    );
@@ -756,30 +919,36 @@ auto moo::game::draw_gui() -> void{
       gui_text += fmt::format(", strategy change in: {}", m_strategy_change_cooldown.to_string());
    if (!m_ufo.has_value())
       gui_text += fmt::format(", ufo spawn in: {}", m_ufo_spawn_timer.to_string());
+
+   // Narrow terminals get the beginning only, the text has to end on screen
+   const size_t max_length = static_cast<size_t>(std::max(static_columns - 1, 0));
+   if (gui_text.length() > max_length)
+      gui_text.resize(max_length);
    write_screen_text(gui_text, { 0, 0 }, RGB{255, 0, 0});
 }
 
 
-auto moo::game::draw_cows() -> void{
+auto moo::game::add_cows() -> void{
    ZoneScoped;
    m_registry.view<IsCow, Alpha, AnimationFrame, CowVariant, LanePosition>().each([&](
       Alpha& alpha, AnimationFrame& anim_frame, CowVariant& cow_variant, LanePosition& lane_pos
       ) {
          const size_t animation_index = anim_frame.get_index();
-         write_image_at_pos(
-            m_registry.get<CowAnimation>(cow_variant)[animation_index],
+         add_sprite_draw(get_sprite_draw(
+            m_registry.get<CowAnimation>(cow_variant).m_sprites[animation_index],
             lane_pos.get_screen_pos(),
             WriteAlignment::BottomCenter,
             alpha,
             std::nullopt,
             get_cow_fade(lane_pos)
-         );
+         ));
       }
    );
 }
 
 
 auto moo::game::draw_shadow(
+   const Band& band,
    const ScreenCoord& player_pos,
    const int max_shadow_width,
    const int shadow_x_offset
@@ -787,6 +956,8 @@ auto moo::game::draw_shadow(
 {
    ZoneScoped;
    const LineCoord shadow_center = get_shadow_center_pos(player_pos);
+   if (shadow_center.i < band.begin_i || shadow_center.i >= band.end_i)
+      return;
    const double height_fraction = get_height_fraction(player_pos);
    const int shadow_width = static_cast<int>(height_fraction * max_shadow_width);
    for (int j = 0; j < shadow_width; ++j) {
@@ -794,18 +965,7 @@ auto moo::game::draw_shadow(
       const size_t index = to_screen_index(ppos);
       const double color_fraction = height_fraction * get_triangle(1.0 * j / shadow_width);
       m_bg_buffer[index] = get_offsetted_color(m_bg_buffer[index], static_cast<int>(-20.0 * color_fraction));
-   }
-}
-
-
-auto moo::game::draw_buffer_to_bg(const BgBuffer& buffer) -> void{
-   for (int i = 0; i < static_rows; ++i) {
-      for (int j = 0; j < static_columns; ++j) {
-         const int index = i * static_columns + j;
-         if (is_zero(buffer[index].m_alpha))
-            continue;
-         m_bg_buffer[index] = get_color_mix(m_bg_buffer[index], buffer[index].m_rgb, buffer[index].m_alpha);
-      }
+      m_bg_damage.add(ppos);
    }
 }
 
@@ -871,34 +1031,54 @@ void moo::game::write_logo(){
 }
 
 
-void moo::game::write_image_at_pos(
-   const ImageWrapper& image,
+auto moo::game::get_sprite_draw(
+   const Sprite& sprite,
    const ScreenCoord& screen_pos,
    const WriteAlignment write_alignment,
    const double alpha,
    const std::optional<RGB>& override_color,
    const double fade
-){
-   ZoneScoped;
-   PixelCoord top_left_pos = get_top_left(to_pixel_coord(screen_pos), image.get_dim<PixelCoord>());
+) -> SpriteDraw
+{
+   PixelCoord top_left_pos = get_top_left(to_pixel_coord(screen_pos), sprite.get_dim<PixelCoord>());
    if (write_alignment == WriteAlignment::BottomCenter)
-      top_left_pos.i -= image.m_height / 2;
+      top_left_pos.i -= sprite.m_height / 2;
 
-   for (PixelCoordIt image_it(image); image_it.is_valid(); ++image_it) {
-      const PixelCoord canvas_coord = top_left_pos + *image_it;
-      if (image_it.get_image_pixel().is_visible() && is_on_screen(canvas_coord)) {
-         if (override_color.has_value()) {
-            m_pixel_buffer[to_screen_index(canvas_coord)] = override_color.value();
-         }
-         else {
-            auto bg_index = to_screen_index(to_line_coord(canvas_coord));
-            auto bg_color = m_bg_buffer[bg_index];
-            const RGB faded = get_color_mix(image_it.get_image_pixel(), RGB{ 0, 0, 0 }, fade);
-            const RGB alpha_blended = get_color_mix(bg_color, faded, alpha);
-            m_pixel_buffer[to_screen_index(canvas_coord)] = alpha_blended;
-         }
+   // An override color is a fill that doesn't need the pixels, so only the other case is worth a faded copy
+   const Sprite& drawn = override_color.has_value() ? sprite : m_sprite_cache.get_faded(sprite, get_blend_factor(fade));
+   return { &drawn, top_left_pos, get_blend_factor(alpha), override_color };
+}
+
+
+auto moo::game::add_sprite_draw(const SpriteDraw& draw) -> void{
+   m_draw_list.add(draw, draw.top_left.i, draw.top_left.i + draw.sprite->m_height);
+}
+
+
+auto moo::game::draw_sprite(
+   const SpriteDraw& draw,
+   const Band& band
+) -> void
+{
+   ZoneScoped;
+   const std::optional<RGB>& override_color = draw.override_color;
+   const int alpha_factor = draw.alpha_factor;
+   draw.sprite->for_each_span(draw.top_left, 2 * band.begin_i, 2 * band.end_i, [&](const PixelCoord& start, const std::span<const RGB> pixels) {
+      RGB* target = &m_pixel_buffer[to_screen_index(start)];
+      if (override_color.has_value()) {
+         std::fill(target, target + pixels.size(), override_color.value());
       }
-   }
+      else if (alpha_factor == blend_factor_one) {
+         std::copy(pixels.begin(), pixels.end(), target);
+      }
+      else {
+         const RGB* bg_row = &m_bg_buffer[to_screen_index(LineCoord{ start.i / 2, 0 })];
+         for (size_t k = 0; k < pixels.size(); ++k)
+            target[k] = get_fixed_color_mix(bg_row[(start.j + k) / 2], pixels[k], alpha_factor);
+      }
+      const int end_j = start.j + static_cast<int>(pixels.size());
+      m_pixel_damage.add(LineCoord{ start.i / 2, start.j / 2 }, LineCoord{ start.i / 2 + 1, (end_j + 1) / 2 });
+   });
 }
 
 
@@ -919,34 +1099,34 @@ void moo::game::write_screen_text(
       const size_t index = to_screen_index(start_pos) + i_text;
       m_screen_text[index] = { text[i_text], color };
    }
+   m_text_damage.add(start_pos, start_pos + LineCoord{ 1, static_cast<int>(text.length()) });
 }
 
 
+// Only what was written last frame
 void moo::game::clear_buffers(){
-   std::fill(m_screen_text.begin(), m_screen_text.end(), OverlayCharacter{ '\0', std::nullopt });
-   std::fill(m_pixel_buffer.begin(), m_pixel_buffer.end(), RGB{});
-}
-
-
-void moo::game::refresh_mouse_pos(){
-   ZoneScopedC(0x0000ff);
-   POINT mouse_pos;
-   GetCursorPos(&mouse_pos);
-   m_mouse_pos.x = 1.0 * (mouse_pos.x - m_window_rect.top_left.j) / (m_window_rect.get_width() - 20);
-   m_mouse_pos.y = 1.0 * (mouse_pos.y - m_window_rect.top_left.i) / m_window_rect.get_height();
-}
-
+   ZoneScoped;
+   m_text_damage.next_frame();
+   m_pixel_damage.next_frame();
+   for (int i = 0; i < static_rows; ++i) {
+      const ColumnRange text_range = m_text_damage.get_previous(i);
+      for (int j = text_range.begin_j; j < text_range.end_j; ++j)
+         m_screen_text[to_screen_index(LineCoord{ i, j })] = OverlayCharacter{ '\0', std::nullopt };
 
-void moo::game::refresh_window_rect(){
-   ZoneScopedC(0x0000ff);
-   m_window_rect = get_window_rect();
+      const ColumnRange pixel_range = m_pixel_damage.get_previous(i);
+      if (pixel_range.is_empty())
+         continue;
+      for (const int pixel_i : { 2 * i, 2 * i + 1 }) {
+         const auto row_begin = m_pixel_buffer.begin() + to_screen_index(PixelCoord{ pixel_i, 2 * pixel_range.begin_j });
+         std::fill(row_begin, row_begin + 2 * (pixel_range.end_j - pixel_range.begin_j), RGB{});
+      }
+   }
 }
 
 
-void moo::game::handle_mouse_click(){
-   const bool lmb_clicked = get_config().enable_mouse && GetKeyState(VK_LBUTTON) < 0;
-   const bool space_clicked = GetKeyState(VK_SPACE) < 0;
-   if (lmb_clicked || space_clicked)
+void moo::game::handle_mouse_click(const Input& input){
+   const bool lmb_clicked = get_config().enable_mouse && input.lmb_pressed;
+   if (lmb_clicked || input.space_pressed)
       m_player.try_to_fire(m_registry);
 }
 
@@ -956,7 +1136,8 @@ void moo::game::add_clouds(const int n, const bool off_screen){
    std::uniform_real_distribution<double> y_pos_dist(0.0, max_y_pos);
    for (int i = 0; i < n; ++i) {
       auto cloud_images = m_registry.view<CloudImage>();
-      auto cloud_image_ref = cloud_images[rand() % cloud_images.size()];
+      std::uniform_int_distribution<size_t> image_dist(0, cloud_images.size() - 1);
+      auto cloud_image_ref = cloud_images[image_dist(get_rng())];
       const CloudImage& cloud_image = m_registry.get<CloudImage>(cloud_image_ref);
       const double fractional_width = 1.0 * cloud_image.m_width / static_columns;
       ScreenCoord cloud_pos{ (i + 0.5) / n , y_pos_dist(get_rng()) };
@@ -972,28 +1153,75 @@ void moo::game::add_clouds(const int n, const bool off_screen){
 
 
 moo::GrassNoise::GrassNoise(const int grass_rows, const int columns)
-   : m_anim_offsets(grass_rows, 0)
+   : m_ring_size(2 * columns)
+   , m_anim_offsets(grass_rows, 0)
+   , m_ring_offsets(grass_rows, 0)
 {
    constexpr int noise_strength = 5;
    std::uniform_int_distribution<> m_noise_dist(-noise_strength, noise_strength);
-   m_row_noise.reserve(grass_rows);
+   m_noise.reserve(static_cast<size_t>(grass_rows) * m_ring_size);
 
    for (int i = 0; i < grass_rows; ++i) {
       const double row_progress = 1.0 * i / grass_rows;
-      std::vector<int> noise;
-      const size_t noise_size = 2 * columns;
-      noise.reserve(noise_size);
       const int distance = 3 + static_cast<int>(17.0 * get_rising(row_progress, 0.0, 1.0));
       int noise_offset = 0;
       int color_life_left = distance;
-      for (int j = 0; j < noise_size; ++j) {
+      for (int j = 0; j < m_ring_size; ++j) {
          if (color_life_left == 0) {
             color_life_left = distance;
             noise_offset = m_noise_dist(get_rng());
          }
-         noise.emplace_back(noise_offset);
+         m_noise.emplace_back(static_cast<std::int8_t>(noise_offset));
          --color_life_left;
       }
-      m_row_noise.emplace_back(std::move(noise));
+   }
+}
+
+
+auto moo::GrassNoise::get_noise(const int lane, const int ring_index) const -> int{
+   return m_noise[static_cast<size_t>(lane) * m_ring_size + ring_index];
+}
+
+
+auto moo::DrawList::clear(const int band_count) -> void{
+   m_clouds.clear();
+   m_beam_rows.clear();
+   m_draw_shadow = false;
+   m_pixel_draws.clear();
+   m_band_draws.resize(band_count);
+   for (std::vector<int>& band_draws : m_band_draws)
+      band_draws.clear();
+}
+
+
+// Into every band that the pixel rows [begin_pixel_i, end_pixel_i) touch
+auto moo::DrawList::add(
+   const PixelDraw& draw,
+   const int begin_pixel_i,
+   const int end_pixel_i
+) -> void
+{
+   const int draw_index = static_cast<int>(m_pixel_draws.size());
+   m_pixel_draws.push_back(draw);
+   const int band_count = static_cast<int>(m_band_draws.size());
+   const int begin_band = std::max(begin_pixel_i / 2 / band_rows, 0);
+   const int end_band = std::min((end_pixel_i - 1) / 2 / band_rows + 1, band_count);
+   for (int band_index = begin_band; band_index < end_band; ++band_index)
+      m_band_draws[band_index].push_back(draw_index);
+}
+
+
+moo::SkyAndGround::SkyAndGround(const GrassNoise& grass_noise) {
+   const int sky_height = get_sky_row_height();
+   m_sky_colors.reserve(sky_height);
+   for (int i = 0; i < sky_height; ++i)
+      m_sky_colors.emplace_back(get_sky_color(1.0 * i / sky_height));
+
+   const int ground_height = get_ground_row_height();
+   m_ground_rings.reserve(static_cast<size_t>(ground_height) * grass_noise.m_ring_size);
+   for (int lane = 0; lane < ground_height; ++lane) {
+      const RGB base_color = get_ground_color(1.0 * lane / ground_height);
+      for (int ring_index = 0; ring_index < grass_noise.m_ring_size; ++ring_index)
+         m_ground_rings.emplace_back(get_offsetted_color(base_color, grass_noise.get_noise(lane, ring_index)));
    }
 }
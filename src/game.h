@@ -1,25 +1,31 @@
 #pragma once
 
+#include "block_cell.h"
 #include "block_char.h"
 #include "buffer.h"
+#include "cell.h"
 #include "color.h"
 #include "cooldown.h"
+#include "damage.h"
 #include "entt_types.h"
 #include "fps_counter.h"
+#include "headless_target.h"
+#include "frame_writer.h"
 #include "helpers.h"
 #include "image.h"
 #include "lane_position.h"
+#include "layer_blending.h"
+#include "layer_stack.h"
 #include "mountain_range.h"
-#include "painter.h"
 #include "player.h"
+#include "resolution_scaler.h"
+#include "terminal.h"
+#include "thread_pool.h"
 #include "ufo.h"
-#include "win_api_helper.h"
 
+#include <cstdint>
 #include <string>
-
-#define NOMINMAX
-#define WIN32_LEAN_AND_MEAN
-#include <windows.h>
+#include <variant>
 
 #include <entt/entt.hpp>
 
@@ -27,10 +33,81 @@ namespace moo {
 
    struct Trail;
 
+   // One ring of noise per grass row, all in one block. Every lane scrolls through its ring by its offset.
    struct GrassNoise {
       GrassNoise(const int grass_rows, const int columns);
-      std::vector<std::vector<int>> m_row_noise;
+      [[nodiscard]] auto get_noise(const int lane, const int ring_index) const -> int;
+
+      int m_ring_size = 0;
+      std::vector<std::int8_t> m_noise;
       std::vector<double> m_anim_offsets;
+      std::vector<int> m_ring_offsets;
+   };
+
+   /// <summary>Sky and ground before anything is drawn over them, computed once for the screen size. The
+   /// sky has one color per row, the ground rows are the grass noise rings with their colors applied.</summary>
+   struct SkyAndGround {
+      explicit SkyAndGround(const GrassNoise& grass_noise);
+
+      std::vector<RGB> m_sky_colors;
+      std::vector<RGB> m_ground_rings;
+   };
+
+   // Whole screen rows [begin_i, end_i). The bands get drawn in parallel, every one by a single thread.
+   struct Band {
+      int index = 0;
+      int begin_i = 0;
+      int end_i = 0;
+
+      [[nodiscard]] constexpr auto contains_pixel_row(const int pixel_i) const -> bool {
+         return pixel_i >= 2 * begin_i && pixel_i < 2 * end_i;
+      }
+   };
+
+   struct CloudDraw {
+      ImageWrapper image;
+      LineCoord top_left;
+      double fmod = 0.0;
+   };
+
+   // One row of the beam, brightened by one factor
+   struct BeamRow {
+      int i = 0;
+      ColumnRange range;
+      int factor = 0;
+   };
+
+   struct SpriteDraw {
+      const Sprite* sprite = nullptr;
+      PixelCoord top_left;
+      int alpha_factor = 0;
+      std::optional<RGB> override_color;
+   };
+
+   struct PuffDraw {
+      PixelCoord pos;
+      RGB color;
+   };
+
+   struct BulletDraw {
+      PixelCoord pos;
+      BulletStyle style = BulletStyle::Rocket;
+   };
+
+   using PixelDraw = std::variant<SpriteDraw, PuffDraw, BulletDraw>;
+
+   /// <summary>Everything a frame draws over sky, ground and mountains, gathered before drawing. Only the
+   /// gathering reads the registry and the sprite cache, so the bands draw without sharing anything. The
+   /// pixel draws keep their order and are binned by the bands they touch.</summary>
+   struct DrawList {
+      auto clear(const int band_count) -> void;
+      auto add(const PixelDraw& draw, const int begin_pixel_i, const int end_pixel_i) -> void;
+
+      std::vector<CloudDraw> m_clouds;
+      std::vector<BeamRow> m_beam_rows;
+      bool m_draw_shadow = false;
+      std::vector<PixelDraw> m_pixel_draws;
+      std::vector<std::vector<int>> m_band_draws; // Indices into m_pixel_draws
    };
 
    struct OverlayCharacter {
@@ -43,68 +120,82 @@ namespace moo {
    enum class ContinueWish{Continue, Exit, GameOver};
 
    struct game {
-      game();
+      explicit game(HeadlessTarget* headless_target = nullptr);
       auto run() -> void;
+      auto run_headless(const int frame_count) -> void;
       [[nodiscard]] auto game_loop() -> ContinueWish;
+      [[nodiscard]] auto step(const Input& input, const Seconds dt) -> ContinueWish;
       void combine_buffers(const bool draw_fg);
-      void write_image_at_pos(const ImageWrapper& image, const ScreenCoord& pos, const WriteAlignment write_alignment, const double alpha, const std::optional<RGB>& override_color, const double fade);
+      [[nodiscard]] auto get_sprite_draw(const Sprite& sprite, const ScreenCoord& pos, const WriteAlignment write_alignment, const double alpha, const std::optional<RGB>& override_color, const double fade) -> SpriteDraw;
+      auto add_sprite_draw(const SpriteDraw& draw) -> void;
+      auto draw_sprite(const SpriteDraw& draw, const Band& band) -> void;
       void write_screen_text(const std::string& text, const LineCoord& start_pos, const std::optional<RGB>& color);
       void clear_buffers();
-      void refresh_mouse_pos();
-      void refresh_window_rect();
-      void handle_mouse_click();
-      auto get_bg_color(const LineCoord& line_coord) const -> RGB;
+      void handle_mouse_click(const Input& input);
       auto iterate_grass_movement(const Seconds dt) -> void;
       void add_clouds(const int n, const bool off_screen);
       void early_test(const bool use_colors);
-      void write_one_block(
+      [[nodiscard]] auto get_block_cell(
          const BlockChar& block_char,
          const RGB row_bg_color,
          const bool draw_foreground
-      );
+      ) const -> Cell;
 
       [[nodiscard]] auto get_block_char_from_fg(const LineCoord& line_coord) const -> BlockChar;
-      auto draw_sky_and_ground() -> void;
-      auto draw_mountain(const BgColorBuffer& mountain, BgBuffer& target, const double alpha) -> void;
-      auto draw_mountain_range(const MountainRange& mountains) -> void;
-      auto draw_mountains() -> void;
-      auto draw_background() -> void;
-      auto draw_puff(const ScreenCoord& puff_screen_pos, const RGB& color) -> void;
-      auto draw_trail(const Trail& trail) -> void;
-      auto draw_bullet(const Bullet& bullet) -> void;
-      auto draw_beam(const Ufo& ufo) -> void;
+      [[nodiscard]] auto get_half_block_from_fg(const LineCoord& line_coord) const -> HalfBlock;
+      auto draw_far_layers(const Band& band) -> void;
+      auto draw_sky_and_ground(const Band& band) -> void;
+      auto draw_mountain_range(const MountainRange& mountains, const Band& band) -> void;
+      auto draw_clouds(const Band& band) -> void;
+      auto draw_background(const Band& band) -> void;
+      auto fade_bg() -> void;
+      auto write_pixel(const PixelCoord& pos, const RGB& color) -> void;
+      auto add_puff(const ScreenCoord& puff_screen_pos, const RGB& color) -> void;
+      auto add_trail(const Trail& trail) -> void;
+      auto add_bullet(const Bullet& bullet) -> void;
+      auto draw_puff(const PuffDraw& puff, const Band& band) -> void;
+      auto draw_bullet(const BulletDraw& bullet, const Band& band) -> void;
+      auto add_beam(const Ufo& ufo) -> void;
+      auto draw_beam(const Band& band) -> void;
       auto do_cow_logic(const Seconds dt) -> void;
       auto do_cloud_logic(const Seconds dt) -> void;
-      auto do_logic(const Seconds dt) -> std::optional<ContinueWish>;
+      auto do_logic(const Input& input, const Seconds dt) -> std::optional<ContinueWish>;
+      auto gather_drawing(const bool draw_fg) -> void;
+      auto draw_band(const Band& band) -> void;
       auto do_drawing(const bool draw_fg) -> void;
       auto draw_gui() -> void;
       
-      auto draw_cows() -> void;
-      auto draw_shadow(const ScreenCoord& player_pos, const int max_shadow_width, const int shadow_x_offset) -> void;
-      auto draw_buffer_to_bg(const BgBuffer& buffer) -> void;
-
-      ConsoleState m_initial_console_state;
-      Rect m_window_rect;
-      HANDLE m_output_handle;
-      HANDLE m_input_handle;
-      Painter m_painter;
+      auto add_cows() -> void;
+      auto draw_shadow(const Band& band, const ScreenCoord& player_pos, const int max_shadow_width, const int shadow_x_offset) -> void;
+
+      std::optional<Terminal> m_terminal;
+      FrameWriter m_frame_writer;
       BgColorBuffer m_bg_buffer;
+      BgColorBuffer m_faded_bg_buffer;
+      std::optional<double> m_faded_bg_fade;
       GrassNoise m_grass_noise;
+      SkyAndGround m_sky_and_ground;
       std::vector<OverlayCharacter> m_screen_text;
-      std::wstring m_output_string;
       Animation m_player_animation;
       AnimationFrame m_player_anim_frame;
       Animation m_ufo_animation;
       std::vector<RGB> m_pixel_buffer;
-      ScreenCoord m_mouse_pos;
+      SpriteCache m_sprite_cache{ 1 << 16 }; // pixels
+      DamageTracker m_bg_damage;
+      DamageTracker m_text_damage;
+      DamageTracker m_pixel_damage;
       FpsCounter m_fps_counter;
+      ResolutionScaler m_resolution_scaler;
       std::chrono::time_point<std::chrono::system_clock> m_t_last;
       Player m_player;
       entt::registry m_registry;
-      BgBuffer m_blending_buffer;
+      ThreadPool m_thread_pool{ get_default_worker_count() };
+      DrawList m_draw_list;
+      std::vector<BlendingArea> m_cloud_areas; // One per band
       MountainRange m_front_mountain;
       MountainRange m_middle_mountain;
       MountainRange m_back_mountain;
+      LayerStack m_far_layers; // Sky, back and middle mountains
       double m_time = 0.0;
       int m_level = 0;
       Cooldown m_strategy_change_cooldown = 10.0;
@@ -114,8 +114,8 @@ namespace {
    {
       auto entity = registry.create();
       constexpr double puff_variation = 0.02;
-      const std::uniform_real_distribution<double> pos_var_dist(-puff_variation, puff_variation);
-      const std::uniform_int_distribution<> green_dist(0, 255);
+      std::uniform_real_distribution<double> pos_var_dist(-puff_variation, puff_variation);
+      std::uniform_int_distribution<> green_dist(0, 255);
       const ScreenCoord puff_pos = pos + ScreenCoord{ pos_var_dist(get_rng()), pos_var_dist(get_rng()) };
       const RGB color{ 255, static_cast<unsigned char>(green_dist(get_rng())), 0 };
       registry.emplace<IsPuff>(entity);
@@ -267,7 +267,7 @@ auto moo::do_explosion_logic(entt::registry& registry, const Seconds dt) -> void
       }
       });
 
-   const std::uniform_real_distribution<double> one_dist(0.0, 1.0);
+   std::uniform_real_distribution<double> one_dist(0.0, 1.0);
    const double elim_threshold = 5.0 * dt;
    registry.view<IsPuff>().each([&](entt::entity ett) {
       if (one_dist(get_rng()) < elim_threshold)
@@ -336,7 +336,7 @@ auto moo::create_explosion(entt::registry& registry, const ScreenCoord& start_po
 
    const double average_angle = 2.0 * pi / explosion_streak_count;
    const double angle_var = 0.5 * average_angle;
-   const std::uniform_real_distribution<double> angle_var_dist(-angle_var, angle_var);
+   std::uniform_real_distribution<double> angle_var_dist(-angle_var, angle_var);
 
    for (int i = 0; i < explosion_streak_count; ++i) {
       const double angle = i * average_angle + angle_var_dist(get_rng());
@@ -0,0 +1,362 @@
+﻿#include "headless_target.h"
+
+#include "frame_encoder.h"
+#include "palette.h"
+
+#include <array>
+#include <charconv>
+#include <fstream>
+#include <random>
+
+#include <doctest/doctest.h>
+#include <fmt\format.h>
+#include <Tracy.hpp>
+
+
+namespace {
+
+   // Bits for the top left, top right, bottom left and bottom right quarter of a cell
+   [[nodiscard]] constexpr auto get_quadrant_mask(const wchar_t glyph) -> unsigned int {
+      switch (glyph) {
+      case L' ': return 0b0000;
+      case L'▘': return 0b0001;
+      case L'▝': return 0b0010;
+      case L'▀': return 0b0011;
+      case L'▖': return 0b0100;
+      case L'▌': return 0b0101;
+      case L'▞': return 0b0110;
+      case L'▛': return 0b0111;
+      case L'▗': return 0b1000;
+      case L'▚': return 0b1001;
+      case L'▐': return 0b1010;
+      case L'▜': return 0b1011;
+      case L'▄': return 0b1100;
+      case L'▙': return 0b1101;
+      case L'▟': return 0b1110;
+      default: return 0b1111; // full block, and text is shown as solid foreground
+      }
+   }
+
+
+   [[nodiscard]] auto get_parameters(const std::string_view parameters) -> std::vector<int> {
+      std::vector<int> result;
+      size_t begin = 0;
+      while (begin <= parameters.size()) {
+         size_t end = parameters.find(';', begin);
+         if (end == std::string_view::npos)
+            end = parameters.size();
+         int value = 0;
+         std::from_chars(parameters.data() + begin, parameters.data() + end, value);
+         result.push_back(value);
+         begin = end + 1;
+      }
+      return result;
+   }
+
+
+   [[nodiscard]] auto get_parameter(
+      const std::vector<int>& parameters,
+      const size_t index,
+      const int default_value
+   ) -> int
+   {
+      if (index >= parameters.size() || parameters[index] == 0)
+         return default_value;
+      return parameters[index];
+   }
+
+
+   // Only the block elements and ASCII ever get written, so three bytes at most
+   [[nodiscard]] auto decode_utf8(
+      const std::string_view bytes,
+      size_t& pos
+   ) -> wchar_t
+   {
+      const unsigned char first = static_cast<unsigned char>(bytes[pos]);
+      if (first < 0x80) {
+         ++pos;
+         return static_cast<wchar_t>(first);
+      }
+      if ((first & 0xE0) == 0xC0 && pos + 1 < bytes.size()) {
+         const unsigned int code_point = ((first & 0x1F) << 6) | (bytes[pos + 1] & 0x3F);
+         pos += 2;
+         return static_cast<wchar_t>(code_point);
+      }
+      if (pos + 2 < bytes.size()) {
+         const unsigned int code_point = ((first & 0x0F) << 12) | ((bytes[pos + 1] & 0x3F) << 6) | (bytes[pos + 2] & 0x3F);
+         pos += 3;
+         return static_cast<wchar_t>(code_point);
+      }
+      pos = bytes.size();
+      return L'?';
+   }
+
+
+   // From the SGR codes 30-37, 40-47, 90-97 and 100-107
+   [[nodiscard]] auto get_ansi_16_color(const int code) -> moo::RGB {
+      const int base = code % 10;
+      const bool bright = code >= 90;
+      return moo::get_palette_color(static_cast<unsigned char>(base + (bright ? 8 : 0)));
+   }
+
+} // namespace {}
+
+
+auto moo::get_cell_pixels(const Cell& cell) -> std::array<RGB, 4>{
+   const unsigned int mask = get_quadrant_mask(cell.glyph);
+   std::array<RGB, 4> pixels;
+   for (unsigned int i = 0; i < 4; ++i)
+      pixels[i] = ((mask >> i) & 1) ? cell.fg : cell.bg;
+   return pixels;
+}
+
+
+moo::HeadlessTarget::HeadlessTarget(const std::optional<std::filesystem::path>& dump_directory)
+   : m_dump_directory(dump_directory)
+{
+   if (m_dump_directory.has_value())
+      std::filesystem::create_directories(m_dump_directory.value());
+}
+
+
+auto moo::HeadlessTarget::write(const std::string_view utf8_str) -> void{
+   ZoneScoped;
+   m_last_frame = utf8_str;
+   m_frame_sizes.push_back(utf8_str.size());
+   decode(utf8_str);
+   if (m_dump_directory.has_value()) {
+      const size_t frame_index = m_frame_sizes.size() - 1;
+      dump_ans(m_dump_directory.value() / fmt::format("frame_{:05}.ans", frame_index));
+      dump_ppm(m_dump_directory.value() / fmt::format("frame_{:05}.ppm", frame_index));
+   }
+}
+
+
+auto moo::HeadlessTarget::get_last_frame() const -> std::string_view{
+   return m_last_frame;
+}
+
+
+auto moo::HeadlessTarget::get_cells() const -> const CellBuffer&{
+   return m_cells;
+}
+
+
+auto moo::HeadlessTarget::get_frame_sizes() const -> const std::vector<size_t>&{
+   return m_frame_sizes;
+}
+
+
+auto moo::HeadlessTarget::dump_ans(const std::filesystem::path& path) const -> void{
+   std::ofstream file(path, std::ios::binary);
+   file.write(m_last_frame.data(), static_cast<std::streamsize>(m_last_frame.size()));
+}
+
+
+auto moo::HeadlessTarget::dump_ppm(const std::filesystem::path& path) const -> void{
+   const int width = 2 * static_columns;
+   const int height = 2 * static_rows;
+   std::vector<char> pixel_bytes(3 * static_cast<size_t>(width) * height);
+   for (LineCoordIt it = get_screen_it(); it.is_valid(); ++it) {
+      const std::array<RGB, 4> pixels = get_cell_pixels(m_cells[it.to_range_index()]);
+      for (int quadrant = 0; quadrant < 4; ++quadrant) {
+         const int x = 2 * it->j + quadrant % 2;
+         const int y = 2 * it->i + quadrant / 2;
+         const size_t offset = 3 * (static_cast<size_t>(y) * width + x);
+         pixel_bytes[offset + 0] = static_cast<char>(pixels[quadrant].r);
+         pixel_bytes[offset + 1] = static_cast<char>(pixels[quadrant].g);
+         pixel_bytes[offset + 2] = static_cast<char>(pixels[quadrant].b);
+      }
+   }
+   std::ofstream file(path, std::ios::binary);
+   file << fmt::format("P6\n{} {}\n255\n", width, height);
+   file.write(pixel_bytes.data(), static_cast<std::streamsize>(pixel_bytes.size()));
+}
+
+
+auto moo::HeadlessTarget::decode(const std::string_view bytes) -> void{
+   size_t pos = 0;
+   while (pos < bytes.size()) {
+      if (bytes[pos] == '\r') {
+         m_cursor.j = 0;
+         m_wrap_pending = false;
+         ++pos;
+         continue;
+      }
+      if (bytes[pos] == '\n') {
+         m_cursor.i = std::min(m_cursor.i + 1, static_rows - 1);
+         m_wrap_pending = false;
+         ++pos;
+         continue;
+      }
+      if (bytes[pos] != '\x1b') {
+         print(decode_utf8(bytes, pos));
+         continue;
+      }
+
+      // CSI: ESC [, parameter bytes, then one final byte
+      size_t end = pos + 2;
+      while (end < bytes.size() && (bytes[end] < 0x40 || bytes[end] > 0x7E))
+         ++end;
+      if (end >= bytes.size())
+         return;
+      apply_sequence(bytes.substr(pos + 2, end - pos - 2), bytes[end]);
+      pos = end + 1;
+   }
+}
+
+
+auto moo::HeadlessTarget::apply_sequence(
+   const std::string_view parameters,
+   const char final_char
+) -> void
+{
+   // Private modes like the cursor visibility don't change the grid
+   if (!parameters.empty() && parameters.front() == '?')
+      return;
+   const std::vector<int> values = get_parameters(parameters);
+   switch (final_char) {
+   case 'H':
+      m_cursor = { get_parameter(values, 0, 1) - 1, get_parameter(values, 1, 1) - 1 };
+      m_wrap_pending = false;
+      break;
+   case 'C':
+      m_cursor.j = std::min(m_cursor.j + get_parameter(values, 0, 1), static_columns - 1);
+      m_wrap_pending = false;
+      break;
+   case 'm':
+      apply_sgr(values);
+      break;
+   case 'X':
+      erase(m_cursor.j, std::min(m_cursor.j + get_parameter(values, 0, 1), static_columns));
+      break;
+   case 'K':
+      erase(m_cursor.j, static_columns);
+      m_wrap_pending = false;
+      break;
+   case 'b':
+      for (int i = get_parameter(values, 0, 1); i > 0; --i)
+         print(m_last_glyph);
+      break;
+   default:
+      break;
+   }
+}
+
+
+auto moo::HeadlessTarget::apply_sgr(const std::vector<int>& values) -> void{
+   for (size_t i = 0; i < values.size(); ++i) {
+      const int code = values[i];
+      if (code == 38 || code == 48) {
+         RGB& target = (code == 38) ? m_fg : m_bg;
+         if (get_parameter(values, i + 1, 0) == 2 && i + 4 < values.size()) {
+            target = {
+               static_cast<unsigned char>(values[i + 2]),
+               static_cast<unsigned char>(values[i + 3]),
+               static_cast<unsigned char>(values[i + 4])
+            };
+            i += 4;
+         }
+         else if (get_parameter(values, i + 1, 0) == 5 && i + 2 < values.size()) {
+            target = get_palette_color(static_cast<unsigned char>(values[i + 2]));
+            i += 2;
+         }
+      }
+      else if ((code >= 30 && code <= 37) || (code >= 90 && code <= 97)) {
+         m_fg = get_ansi_16_color(code);
+      }
+      else if ((code >= 40 && code <= 47) || (code >= 100 && code <= 107)) {
+         m_bg = get_ansi_16_color(code);
+      }
+   }
+}
+
+
+// Like terminals, the cursor stays on the last column until the next character wraps it
+auto moo::HeadlessTarget::print(const wchar_t glyph) -> void{
+   if (m_wrap_pending) {
+      m_cursor = { m_cursor.i + 1, 0 };
+      m_wrap_pending = false;
+   }
+   if (m_cursor.i >= static_rows)
+      return;
+   m_cells[to_screen_index(m_cursor)] = { glyph, m_fg, m_bg };
+   m_last_glyph = glyph;
+   if (m_cursor.j == static_columns - 1)
+      m_wrap_pending = true;
+   else
+      ++m_cursor.j;
+}
+
+
+// ECH and EL fill with the current background and leave the cursor where it is
+auto moo::HeadlessTarget::erase(
+   const int begin_j,
+   const int end_j
+) -> void
+{
+   for (int j = begin_j; j < end_j; ++j)
+      m_cells[to_screen_index(LineCoord{ m_cursor.i, j })] = { L' ', m_fg, m_bg };
+}
+TEST_CASE("HeadlessTarget decodes what FrameEncoder writes") {
+   using namespace moo;
+   constexpr std::array<wchar_t, 6> glyphs{ L' ', L'▀', L'▄', L'▚', L'█', L'x' };
+   constexpr std::array<RGB, 3> colors{ { {10, 20, 30}, {200, 100, 0}, {0, 0, 0} } };
+   std::mt19937 rng(1);
+   const auto get_random_cell = [&]() {
+      return Cell{ glyphs[rng() % glyphs.size()], colors[rng() % colors.size()], colors[rng() % colors.size()] };
+   };
+
+   // Glyphs may have been flipped, so this compares what's visible
+   const auto get_different_cell_count = [](const HeadlessTarget& target, const CellBuffer& cells) {
+      size_t different_cells = 0;
+      for (size_t index = 0; index < get_char_count(); ++index) {
+         if (get_cell_pixels(target.get_cells()[index]) != get_cell_pixels(cells[index]))
+            ++different_cells;
+      }
+      return different_cells;
+   };
+
+   FrameEncoder encoder(ColorMode::TrueColor);
+   encoder.m_delta_frames = true;
+   encoder.m_compress_runs = true;
+   ByteBuffer str(get_max_frame_size());
+   HeadlessTarget target;
+   CellBuffer cells;
+   for (int frame = 0; frame < 5; ++frame) {
+      for (int i = 0; i < 200; ++i)
+         cells[rng() % get_char_count()] = get_random_cell();
+
+      // Runs to be repeated, and blank ones at the end of a row to be erased
+      const Cell run_cell = get_random_cell();
+      for (int j = 10; j < 40; ++j)
+         cells[to_screen_index(LineCoord{ frame, j })] = run_cell;
+      for (int j = static_columns - 20; j < static_columns; ++j)
+         cells[to_screen_index(LineCoord{ frame + 1, j })] = Cell{ L' ', {}, colors[frame % colors.size()] };
+      str.clear();
+      encoder.encode(cells, str);
+      target.write(str.get_view());
+      CHECK(get_different_cell_count(target, cells) == 0);
+   }
+   CHECK(target.get_frame_sizes().size() == 5);
+
+   // A row printed up to the last column leaves the cursor waiting to wrap. A blank row after it must not be
+   // erased from there
+   for (int j = 0; j < static_columns; ++j) {
+      cells[to_screen_index(LineCoord{ 3, j })] = Cell{ L'x', {1, 2, 3}, {4, 5, 6} };
+      cells[to_screen_index(LineCoord{ 4, j })] = Cell{ L' ', {}, {7, 8, 9} };
+   }
+   str.clear();
+   encoder.encode(cells, str);
+   target.write(str.get_view());
+   CHECK(get_different_cell_count(target, cells) == 0);
+
+   FrameEncoder full_encoder(ColorMode::TrueColor);
+   full_encoder.m_delta_frames = false;
+   full_encoder.m_compress_runs = true;
+   HeadlessTarget full_target;
+   str.clear();
+   full_encoder.encode(cells, str);
+   full_target.write(str.get_view());
+   CHECK(get_different_cell_count(full_target, cells) == 0);
+}
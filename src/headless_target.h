@@ -0,0 +1,51 @@
+﻿#pragma once
+
+#include "cc.h"
+#include "cell.h"
+#include "color.h"
+
+#include <array>
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+
+namespace moo {
+
+   /// <summary>Stands in for the terminal: keeps the bytes of the last frame and decodes them into a cell grid
+   /// like a terminal would. Understands exactly the sequences the frame encoder writes. With a dump directory,
+   /// every frame is also written as .ans (the raw bytes) and .ppm (the decoded grid, 2x2 pixels per cell).
+   /// Frames without changes are written too, as empty ones, so everything is numbered by game frame.</summary>
+   struct HeadlessTarget {
+      explicit HeadlessTarget(const std::optional<std::filesystem::path>& dump_directory = std::nullopt);
+
+      auto write(const std::string_view utf8_str) -> void;
+      [[nodiscard]] auto get_last_frame() const -> std::string_view;
+      [[nodiscard]] auto get_cells() const -> const CellBuffer&;
+      [[nodiscard]] auto get_frame_sizes() const -> const std::vector<size_t>&;
+      auto dump_ans(const std::filesystem::path& path) const -> void;
+      auto dump_ppm(const std::filesystem::path& path) const -> void;
+
+   private:
+      auto decode(const std::string_view bytes) -> void;
+      auto apply_sequence(const std::string_view parameters, const char final_char) -> void;
+      auto apply_sgr(const std::vector<int>& values) -> void;
+      auto print(const wchar_t glyph) -> void;
+      auto erase(const int begin_j, const int end_j) -> void;
+
+      std::optional<std::filesystem::path> m_dump_directory;
+      std::string m_last_frame;
+      std::vector<size_t> m_frame_sizes;
+      CellBuffer m_cells;
+      LineCoord m_cursor;
+      bool m_wrap_pending = false;
+      wchar_t m_last_glyph = L' ';
+      RGB m_fg{ 255, 255, 255 };
+      RGB m_bg{ 0, 0, 0 };
+   };
+
+   [[nodiscard]] auto get_cell_pixels(const Cell& cell) -> std::array<RGB, 4>;
+
+}
@@ -146,6 +146,7 @@ auto moo::load_animation(const fs::path& path_base, const bool dimension_checks)
    for (SingleImage& image : images) {
       animation.m_image_pixels.emplace_back(std::move(image.m_pixels));
    }
+   animation.compile_sprites();
    return animation;
 }
 
@@ -178,6 +179,7 @@ auto moo::load_ufo_animation(const fs::path& path) -> Animation{
       SingleImage rec_im = get_recolored_image(base_image, color_replacements);
       animation.m_image_pixels.emplace_back(std::move(rec_im.m_pixels));
    }
+   animation.compile_sprites();
 
    return animation;
 }
@@ -208,6 +210,14 @@ auto moo::Animation::operator[](const size_t index) const -> ImageWrapper{
    return { m_width, m_height, m_image_pixels[index] };
 }
 
+
+auto moo::Animation::compile_sprites() -> void{
+   m_sprites.clear();
+   m_sprites.reserve(m_image_pixels.size());
+   for (const std::vector<RGB>& pixels : m_image_pixels)
+      m_sprites.emplace_back(m_width, m_height, pixels);
+}
+
 //auto moo::Animation::operator[](const size_t index) -> const std::vector<RGB>&{
 //   return m_image_pixels[index];
 //}
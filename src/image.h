@@ -5,6 +5,7 @@ namespace fs = std::filesystem;
 #include <vector>
 
 #include "color.h"
+#include "sprite.h"
 
 
 namespace moo {
@@ -35,7 +36,9 @@ namespace moo {
    struct Animation {
       Animation(const unsigned int width, const unsigned int height);
       [[nodiscard]] auto operator[](const size_t index) const -> ImageWrapper;
+      auto compile_sprites() -> void;
       std::vector<std::vector<RGB>> m_image_pixels;
+      std::vector<Sprite> m_sprites;
       int m_width = 0;
       int m_height = 0;
    };
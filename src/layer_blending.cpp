@@ -0,0 +1,82 @@
+#include "layer_blending.h"
+
+#include <doctest/doctest.h>
+#include <Tracy.hpp>
+
+
+// Clipped to the screen. Keeps the capacity, so this doesn't allocate once the largest area was seen.
+auto moo::BlendingArea::reset(
+   const LineCoord& top_left,
+   const LineCoord& bottom_right
+) -> void
+{
+   m_top_left = { std::max(top_left.i, 0), std::max(top_left.j, 0) };
+   m_bottom_right = {
+      std::max(std::min(bottom_right.i, static_rows), m_top_left.i),
+      std::max(std::min(bottom_right.j, static_columns), m_top_left.j)
+   };
+   const LineCoord dim = m_bottom_right - m_top_left;
+   m_cells.assign(static_cast<size_t>(dim.i) * dim.j, RGBA{});
+}
+
+
+auto moo::BlendingArea::add(
+   const LineCoord& pos,
+   const RGB& color,
+   const unsigned char alpha
+) -> void
+{
+   if (pos.i < m_top_left.i || pos.i >= m_bottom_right.i || pos.j < m_top_left.j || pos.j >= m_bottom_right.j)
+      return;
+   const int width = m_bottom_right.j - m_top_left.j;
+   RGBA& cell = m_cells[static_cast<size_t>(pos.i - m_top_left.i) * width + (pos.j - m_top_left.j)];
+   cell = get_accumulated(cell, color, alpha);
+}
+
+
+auto moo::BlendingArea::blend_into(BgColorBuffer& target) const -> void{
+   ZoneScoped;
+   const int width = m_bottom_right.j - m_top_left.j;
+   const RGBA* cell = m_cells.data();
+   for (int i = m_top_left.i; i < m_bottom_right.i; ++i) {
+      RGB* row = &target[to_screen_index(LineCoord{ i, m_top_left.j })];
+      for (int j = 0; j < width; ++j, ++cell) {
+         if (cell->m_alpha != 0)
+            row[j] = get_blended(row[j], *cell);
+      }
+   }
+}
+
+
+TEST_CASE("BlendingArea") {
+   using namespace moo;
+   // A shape hanging over the left edge, drawn twice with the second one shifted by a column
+   const auto is_in_shape = [](const LineCoord& pos) {
+      return (pos.i + pos.j) % 3 != 0;
+   };
+   const LineCoord top_left{ 5, -2 };
+   const LineCoord dim{ 4, 6 };
+
+   BgColorBuffer expected;
+   for (RGB& color : expected.m_colors)
+      color = RGB{ 100, 150, 200 };
+   BgColorBuffer target = expected;
+
+   BgBuffer blending_buffer;
+   BlendingArea area;
+   area.reset(top_left + LineCoord{ 0, -1 }, top_left + dim);
+   for (const auto& [offset, alpha] : { std::pair{ LineCoord{ 0, -1 }, 0.3 }, std::pair{ LineCoord{ 0, 0 }, 0.7 } }) {
+      for (LineCoordIt it(dim.j, dim.i); it.is_valid(); ++it) {
+         const LineCoord pos = top_left + offset + *it;
+         if (!is_in_shape(*it))
+            continue;
+         area.add(pos, RGB{ 240, 240, 245 }, get_alpha(alpha));
+         if (is_on_screen(pos))
+            blending_buffer[to_screen_index(pos)] = get_accumulated(blending_buffer[to_screen_index(pos)], RGB{ 240, 240, 245 }, get_alpha(alpha));
+      }
+   }
+   blend_buffer(blending_buffer, expected);
+   area.blend_into(target);
+   CHECK(area.m_top_left == LineCoord{ 5, 0 });
+   CHECK(target.m_colors == expected.m_colors);
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include "blend.h"
+#include "buffer.h"
+#include "cc.h"
+
+#include <vector>
+
+namespace moo {
+
+   /// <summary>Draws a layer into a blending buffer. Black is transparent. The alphas add up, so a layer
+   /// drawn with alpha and its shifted version drawn with 1 - alpha blend smoothly. The cells are
+   /// premultiplied, see get_accumulated().</summary>
+   template<class LayerBuffer, class BlendBuffer>
+   auto add_layer(const LayerBuffer& layer, BlendBuffer& target, const double alpha) -> void;
+
+   /// <summary>Mixes the colors of a blending buffer into the target, each by its alpha</summary>
+   template<class BlendBuffer, class TargetBuffer>
+   auto blend_buffer(const BlendBuffer& buffer, TargetBuffer& target) -> void;
+
+   /// <summary>A blending buffer for only a part of the screen, so that compositing something small costs
+   /// its area instead of the whole screen. Takes screen coordinates and ignores what's outside.</summary>
+   struct BlendingArea {
+      auto reset(const LineCoord& top_left, const LineCoord& bottom_right) -> void;
+      auto add(const LineCoord& pos, const RGB& color, const unsigned char alpha) -> void;
+      auto blend_into(BgColorBuffer& target) const -> void;
+
+      LineCoord m_top_left;
+      LineCoord m_bottom_right;
+      std::vector<RGBA> m_cells;
+   };
+
+}
+
+
+template<class LayerBuffer, class BlendBuffer>
+auto moo::add_layer(
+   const LayerBuffer& layer,
+   BlendBuffer& target,
+   const double alpha
+) -> void
+{
+   const unsigned char alpha_byte = get_alpha(alpha);
+   for (size_t index = 0; index < get_char_count(); ++index) {
+      const RGB color = layer[index];
+      if (color.is_invisible())
+         continue;
+      target[index] = get_accumulated(target[index], color, alpha_byte);
+   }
+}
+
+
+template<class BlendBuffer, class TargetBuffer>
+auto moo::blend_buffer(
+   const BlendBuffer& buffer,
+   TargetBuffer& target
+) -> void
+{
+   for (size_t index = 0; index < get_char_count(); ++index) {
+      const RGBA cell = buffer[index];
+      if (cell.m_alpha == 0)
+         continue;
+      target[index] = get_blended(target[index], cell);
+   }
+}
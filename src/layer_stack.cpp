@@ -0,0 +1,120 @@
+#include "layer_stack.h"
+
+#include "cc.h"
+
+#include <algorithm>
+
+#include <doctest/doctest.h>
+
+
+moo::LayerStack::LayerStack(const std::vector<int>& begin_rows) {
+   m_layers.reserve(begin_rows.size());
+   for (const int begin_i : begin_rows)
+      m_layers.push_back(CachedLayer{ BgColorBuffer{}, begin_i });
+}
+
+
+auto moo::LayerStack::set_version(
+   const size_t layer_index,
+   const size_t version
+) -> void
+{
+   CachedLayer& layer = m_layers[layer_index];
+   if (layer.m_version != version)
+      layer.m_stale = true;
+   layer.m_version = version;
+}
+
+
+// Everything from there up needs to be redrawn. The layer count if nothing does.
+auto moo::LayerStack::get_first_stale() const -> size_t{
+   const auto it = std::find_if(m_layers.begin(), m_layers.end(), [](const CachedLayer& layer) {return layer.m_stale; });
+   return static_cast<size_t>(it - m_layers.begin());
+}
+
+
+// The first row that changes in the top composite this frame. The screen height if nothing does.
+auto moo::LayerStack::get_redrawn_begin_i() const -> int{
+   int begin_i = static_rows;
+   for (size_t layer_index = get_first_stale(); layer_index < m_layers.size(); ++layer_index)
+      begin_i = std::min(begin_i, m_layers[layer_index].m_begin_i);
+   return begin_i;
+}
+
+
+auto moo::LayerStack::start_redraw(
+   const size_t layer_index,
+   const int begin_i,
+   const int end_i
+) -> BgColorBuffer&
+{
+   BgColorBuffer& composite = m_layers[layer_index].m_composite;
+   if (layer_index > 0 && begin_i < end_i) {
+      const BgColorBuffer& below = m_layers[layer_index - 1].m_composite;
+      const size_t begin = to_screen_index(LineCoord{ begin_i, 0 });
+      const size_t end = to_screen_index(LineCoord{ end_i, 0 });
+      std::copy(below.m_colors.begin() + begin, below.m_colors.begin() + end, composite.m_colors.begin() + begin);
+   }
+   return composite;
+}
+
+
+// Stale layers above the first one were redrawn too
+auto moo::LayerStack::finish_frame() -> void{
+   for (CachedLayer& layer : m_layers)
+      layer.m_stale = false;
+}
+
+
+auto moo::LayerStack::get_top() const -> const BgColorBuffer&{
+   return m_layers.back().m_composite;
+}
+
+
+TEST_CASE("LayerStack") {
+   using namespace moo;
+   // A background and two layers that each tint their rows by their version
+   LayerStack stack({ 0, 10, 20 });
+   std::vector<size_t> versions{ 0, 0, 0 };
+   std::vector<int> redraw_counts(3, 0);
+   const auto draw_frame = [&]() {
+      for (size_t layer_index = 0; layer_index < versions.size(); ++layer_index)
+         stack.set_version(layer_index, versions[layer_index]);
+      for (size_t layer_index = stack.get_first_stale(); layer_index < versions.size(); ++layer_index) {
+         ++redraw_counts[layer_index];
+         // In two halves, like two threads would
+         for (const auto& [begin_i, end_i] : { std::pair{ 0, 15 }, std::pair{ 15, static_rows } }) {
+            BgColorBuffer& target = stack.start_redraw(layer_index, begin_i, end_i);
+            for (int i = std::max(begin_i, stack.m_layers[layer_index].m_begin_i); i < end_i; ++i) {
+               for (int j = 0; j < static_columns; ++j) {
+                  RGB& color = target[to_screen_index(LineCoord{ i, j })];
+                  color.r += static_cast<unsigned char>(1 + versions[layer_index]);
+               }
+            }
+         }
+      }
+      stack.finish_frame();
+   };
+   const auto get_top_color = [&](const int i) {
+      return stack.get_top()[to_screen_index(LineCoord{ i, 0 })].r;
+   };
+
+   draw_frame();
+   CHECK(redraw_counts == std::vector<int>{ 1, 1, 1 });
+   CHECK(get_top_color(5) == 1);
+   CHECK(get_top_color(25) == 3);
+
+   draw_frame();
+   CHECK(redraw_counts == std::vector<int>{ 1, 1, 1 });
+   CHECK(stack.get_redrawn_begin_i() == static_rows);
+
+   // Only the changed layer and the one above get redrawn
+   versions[1] = 2;
+   stack.set_version(1, 2);
+   CHECK(stack.get_redrawn_begin_i() == 10);
+   draw_frame();
+   CHECK(redraw_counts == std::vector<int>{ 1, 2, 2 });
+   CHECK(get_top_color(5) == 1);
+   CHECK(get_top_color(15) == 4);
+   CHECK(get_top_color(25) == 5);
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include "buffer.h"
+
+#include <vector>
+
+
+namespace moo {
+
+   // One layer of a LayerStack: itself drawn over all the layers below it
+   struct CachedLayer {
+      BgColorBuffer m_composite;
+      int m_begin_i = 0; // The first row the layer draws into
+      size_t m_version = 0;
+      bool m_stale = true;
+   };
+
+   /// <summary>Background layers that rarely change, each cached as the composite of everything up to it.
+   /// A layer with a new version gets redrawn over the cached composite below it, and so does every layer
+   /// above it. In frames where no version changed, the top composite is ready to be copied.
+   ///
+   /// Per frame: set_version() for every layer, then redraw the layers from get_first_stale() on with
+   /// start_redraw(), then finish_frame(). Redrawing works on rows, so it can be split across threads.
+   /// </summary>
+   struct LayerStack {
+      // One first row per layer, from the bottom layer up
+      explicit LayerStack(const std::vector<int>& begin_rows);
+
+      auto set_version(const size_t layer_index, const size_t version) -> void;
+      [[nodiscard]] auto get_first_stale() const -> size_t;
+      [[nodiscard]] auto get_redrawn_begin_i() const -> int;
+
+      // Copies the rows [begin_i, end_i) of the composite below, for the layer to be drawn over
+      [[nodiscard]] auto start_redraw(const size_t layer_index, const int begin_i, const int end_i) -> BgColorBuffer&;
+      auto finish_frame() -> void;
+      [[nodiscard]] auto get_top() const -> const BgColorBuffer&;
+
+      std::vector<CachedLayer> m_layers;
+   };
+
+}
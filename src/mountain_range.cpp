@@ -1,30 +1,26 @@
 #include "mountain_range.h"
 
+#include "blend.h"
+#include "cc.h"
 #include "helpers.h"
+#include "layer_blending.h"
 #include "rng.h"
 #include "screen_size.h"
 #include "screencoord.h"
 
+#include <cmath>
 
-namespace {
+#include <doctest/doctest.h>
 
-   auto shift_left(moo::BgColorBuffer& buffer) -> void {
-      for (int i = 0; i < moo::static_rows; ++i) {
-         for (int j = 0; j < (moo::static_columns - 1); ++j) {
-            const int index = i * moo::static_columns + j;
-            const int right_index = i * moo::static_columns + (j + 1) % moo::static_columns;
-            std::swap(buffer[index], buffer[right_index]);
-         }
-      }
-   }
 
+namespace {
 
    template<class T>
    constexpr auto get_height_change(
       const T& requirement
    ) -> int
    {
-      const std::uniform_int_distribution<> height_dist(-1, 1);
+      std::uniform_int_distribution<> height_dist(-1, 1);
       int height_diff = height_dist(moo::get_rng());
       while (!requirement(height_diff))
          height_diff = height_dist(moo::get_rng());
@@ -34,11 +30,17 @@ namespace {
 } // namespace {}
 
 
-moo::MountainRange::MountainRange(const int height_baseline, const RGB& color)
-   : m_generator(height_baseline, height_baseline + 3)
+moo::MountainRange::MountainRange(
+   const int height_baseline,
+   const RGB& color,
+   const int offset_steps
+)
+   : m_heights(static_columns + 1, 0)
+   , m_offset_steps(offset_steps)
+   , m_generator(height_baseline, height_baseline + 3)
    , m_color(color)
 {
-   for (int i = 0; i < static_columns; ++i)
+   for (size_t i = 0; i < m_heights.size(); ++i)
       shift_mountain();
 }
 
@@ -53,26 +55,69 @@ auto moo::MountainRange::move(const Seconds& dt) -> void{
 }
 
 
+// The oldest height gets replaced by the new rightmost one
 auto moo::MountainRange::shift_mountain() -> void{
-   m_mountain = m_next_mountain;
-   shift_left(m_next_mountain);
-   write_new_right_column();
+   m_heights[m_head] = m_generator.get_next_height();
+   m_head = (m_head + 1) % m_heights.size();
+   ++m_shift_count;
+}
+
+
+auto moo::MountainRange::get_height(const int ring_index) const -> int{
+   return m_heights[(m_head + ring_index) % m_heights.size()];
 }
 
 
-auto moo::MountainRange::write_new_right_column() -> void{
-   const int sky_row_height = get_sky_row_height();
-   const int new_height = m_generator.get_next_height();
-   const int min_mountain_i = sky_row_height - 1 - new_height;
+// No mountain reaches higher than this
+auto moo::MountainRange::get_top_row() const -> int{
+   return std::max(get_sky_row_height() - m_generator.m_max_height, 0);
+}
+
+
+// How far the range has moved into the next column
+auto moo::MountainRange::get_offset() const -> double{
+   const double offset = sane_fmod(m_position * static_columns, 1.0);
+   if (m_offset_steps == 0)
+      return offset;
+   return std::round(offset * m_offset_steps) / m_offset_steps;
+}
+
+
+// The alpha is all of the offset that drawing uses
+auto moo::MountainRange::get_version() const -> size_t{
+   return m_shift_count * 256 + get_alpha(get_offset());
+}
+
 
-   for (int i = 0; i < sky_row_height; ++i) {
-      const int j = static_columns - 1;
-      const int index = i * static_columns + j;
-      const bool is_mountain = i > min_mountain_i;
-      if (is_mountain)
-         m_next_mountain[index] = m_color;
-      else
-         m_next_mountain[index] = RGB{ 0, 0, 0 };
+// Row by row. A cell is covered by none, one or both of the heights it's drawn from, so there are only three
+// different cells to blend with. That gives exactly what blending the two shifted layers did. Only the rows
+// [begin_i, end_i) are drawn.
+auto moo::MountainRange::draw(
+   BgColorBuffer& target,
+   const int begin_i,
+   const int end_i
+) const -> void
+{
+   const double fmod = get_offset();
+   const RGBA next_only = get_accumulated(RGBA{}, m_color, get_alpha(1.0 - fmod));
+   const RGBA this_only = get_accumulated(RGBA{}, m_color, get_alpha(fmod));
+   const RGBA both = get_accumulated(next_only, m_color, get_alpha(fmod));
+
+   const int sky_height = get_sky_row_height();
+   const int draw_end_i = std::min(end_i, sky_height);
+   for (int i = std::max(begin_i, get_top_row()); i < draw_end_i; ++i) {
+      const int min_height = sky_height - i;
+      RGB* row = &target[to_screen_index(LineCoord{ i, 0 })];
+      size_t ring_index = m_head;
+      bool in_this = m_heights[ring_index] >= min_height;
+      for (int j = 0; j < static_columns; ++j) {
+         if (++ring_index == m_heights.size())
+            ring_index = 0;
+         const bool in_next = m_heights[ring_index] >= min_height;
+         if (in_this || in_next)
+            row[j] = get_blended(row[j], (in_this && in_next) ? both : (in_next ? next_only : this_only));
+         in_this = in_next;
+      }
    }
 }
 
@@ -81,7 +126,7 @@ auto moo::MountainGenerator::get_next_height() -> int{
    ++m_step;
 
    if (m_step % 4 == 0) {
-      const std::uniform_int_distribution<> height_dist(-1, 1);
+      std::uniform_int_distribution<> height_dist(-1, 1);
       auto range_checker = [&](const int change) {
          const int new_height = m_current_height + change;
          return new_height >= m_min_height && new_height <= m_max_height;
@@ -102,3 +147,71 @@ moo::MountainGenerator::MountainGenerator(const int min_height, const int max_he
 {
    
 }
+
+
+TEST_CASE("MountainRange.draw()") {
+   using namespace moo;
+   MountainRange mountains(2, RGB{ 69, 104, 126 });
+   for (int i = 0; i < 50; ++i)
+      mountains.shift_mountain();
+   mountains.m_position = -0.3 / static_columns;
+
+   // What drawing used to be: two full layers, the second one shifted by a column
+   BgColorBuffer mountain;
+   BgColorBuffer next_mountain;
+   const int sky_height = get_sky_row_height();
+   for (int i = 0; i < sky_height; ++i) {
+      for (int j = 0; j < static_columns; ++j) {
+         const size_t index = to_screen_index(LineCoord{ i, j });
+         if (mountains.get_height(j) >= sky_height - i)
+            mountain[index] = mountains.m_color;
+         if (mountains.get_height(j + 1) >= sky_height - i)
+            next_mountain[index] = mountains.m_color;
+      }
+   }
+   const double fmod = sane_fmod(mountains.m_position * static_columns, 1.0);
+   BgBuffer blending_buffer;
+   add_layer(next_mountain, blending_buffer, 1.0 - fmod);
+   add_layer(mountain, blending_buffer, fmod);
+   BgColorBuffer expected;
+   for (RGB& color : expected.m_colors)
+      color = RGB{ 200, 210, 220 };
+   BgColorBuffer drawn = expected;
+   blend_buffer(blending_buffer, expected);
+
+   // In two bands, split in the middle of the mountains
+   const int split_i = (mountains.get_top_row() + sky_height) / 2;
+   mountains.draw(drawn, 0, split_i);
+   mountains.draw(drawn, split_i, static_rows);
+   CHECK(drawn.m_colors == expected.m_colors);
+}
+
+
+TEST_CASE("MountainRange()") {
+   using namespace moo;
+   // Every slot of the ring starts with a generated height, including the one the last column mixes in
+   const MountainRange mountains(2, RGB{ 69, 104, 126 });
+   for (int j = 0; j <= static_columns; ++j)
+      CHECK(mountains.get_height(j) >= 2);
+}
+
+
+TEST_CASE("MountainRange.get_version()") {
+   using namespace moo;
+   MountainRange mountains(2, RGB{ 69, 104, 126 }, 4);
+   mountains.m_position = -0.3 / static_columns;
+   const size_t version = mountains.get_version();
+   CHECK(mountains.get_offset() == doctest::Approx(0.75));
+
+   // Within the same step it looks the same
+   mountains.m_position = -0.32 / static_columns;
+   CHECK(mountains.get_version() == version);
+   mountains.m_position = -0.4 / static_columns;
+   CHECK(mountains.get_version() != version);
+
+   // A shift changes the heights, even if the ring ends up at the same head
+   mountains.m_position = -0.3 / static_columns;
+   for (size_t i = 0; i < mountains.m_heights.size(); ++i)
+      mountains.shift_mountain();
+   CHECK(mountains.get_version() != version);
+}
@@ -22,14 +22,24 @@ namespace moo {
    };
 
 
+   /// <summary>The heights of the mountain columns as a ring, one more than there are columns. Column j is
+   /// drawn from the heights at j and j + 1, mixed by how far the range has moved into the next column.
+   /// With offset steps, that is rounded to as many steps per column, so that the range looks the same for
+   /// several frames and can be cached. The version changes whenever the look does.</summary>
    struct MountainRange {
-      MountainRange(const int height_baseline, const RGB& color);
+      MountainRange(const int height_baseline, const RGB& color, const int offset_steps = 0);
       auto move(const Seconds& dt) -> void;
       auto shift_mountain() -> void;
-      auto write_new_right_column() -> void;
-
-      BgColorBuffer m_mountain;
-      BgColorBuffer m_next_mountain;
+      [[nodiscard]] auto get_height(const int ring_index) const -> int;
+      [[nodiscard]] auto get_top_row() const -> int;
+      [[nodiscard]] auto get_offset() const -> double;
+      [[nodiscard]] auto get_version() const -> size_t;
+      auto draw(BgColorBuffer& target, const int begin_i, const int end_i) const -> void;
+
+      std::vector<int> m_heights;
+      size_t m_head = 0;
+      size_t m_shift_count = 0;
+      int m_offset_steps = 0; // 0 for no rounding
       int m_height_baseline = 0;
       double m_position = 0.0;
       MountainGenerator m_generator;
@@ -1,6 +1,89 @@
 #include "painter.h"
 
+#include <array>
+#include <charconv>
+
+#include <doctest/doctest.h>
+
+
+namespace {
+
+   // SGR 30-37 and 90-97 for the foreground, 40-47 and 100-107 for the background
+   [[nodiscard]] constexpr auto get_ansi_16_code(
+      const unsigned char index,
+      const moo::Layer layer
+   ) -> int
+   {
+      const int layer_offset = (layer == moo::Layer::Back) ? 10 : 0;
+      if (index < 8)
+         return 30 + layer_offset + index;
+      return 90 + layer_offset + index - 8;
+   }
+   static_assert(get_ansi_16_code(1, moo::Layer::Front) == 31);
+   static_assert(get_ansi_16_code(15, moo::Layer::Back) == 107);
+
+
+   struct DecimalString {
+      std::array<char, 3> chars{};
+      unsigned char length = 0;
+   };
+
+
+   [[nodiscard]] constexpr auto get_decimal_string(const int number) -> DecimalString {
+      DecimalString result;
+      if (number >= 100)
+         result.chars[result.length++] = static_cast<char>('0' + number / 100);
+      if (number >= 10)
+         result.chars[result.length++] = static_cast<char>('0' + (number / 10) % 10);
+      result.chars[result.length++] = static_cast<char>('0' + number % 10);
+      return result;
+   }
+
+
+   [[nodiscard]] constexpr auto get_decimal_strings() -> std::array<DecimalString, 256> {
+      std::array<DecimalString, 256> strings;
+      for (int i = 0; i < 256; ++i)
+         strings[i] = get_decimal_string(i);
+      return strings;
+   }
+   constexpr std::array<DecimalString, 256> decimal_strings = get_decimal_strings();
+   static_assert(decimal_strings[7].length == 1 && decimal_strings[7].chars[0] == '7');
+   static_assert(decimal_strings[255].length == 3 && decimal_strings[255].chars[2] == '5');
+
+
+   auto append_channel(const unsigned char value, moo::ByteBuffer& target_str) -> void {
+      const DecimalString& decimal = decimal_strings[value];
+      target_str.append_padded(decimal.chars, decimal.length);
+   }
+
+} // namespace {}
+
 
+void moo::insert_color_string(
+   const moo::RGB& rgb,
+   const Layer layer,
+   ByteBuffer& target_str
+)
+{
+   if (layer == Layer::Back)
+      target_str += "\x1b[48;2;";
+   else
+      target_str += "\x1b[38;2;";
+   append_channel(rgb.r, target_str);
+   target_str += ';';
+   append_channel(rgb.g, target_str);
+   target_str += ';';
+   append_channel(rgb.b, target_str);
+   target_str += 'm';
+}
+TEST_CASE("insert_color_string()") {
+   moo::ByteBuffer str(32);
+   moo::insert_color_string(moo::RGB{ 255, 0, 42 }, moo::Layer::Back, str);
+   CHECK(str.get_view() == "\x1b[48;2;255;0;42m");
+}
+
+
+// The old wide string path. Still used by the intro and for comparison in the benchmark
 void moo::insert_color_string(
    const moo::RGB& rgb, 
    const Layer layer,
@@ -20,10 +103,64 @@ void moo::insert_color_string(
 }
 
 
+void moo::insert_palette_color_string(
+   const unsigned char index,
+   const Layer layer,
+   const ColorMode mode,
+   ByteBuffer& target_str
+)
+{
+   target_str += "\x1b[";
+   if (mode == ColorMode::Palette16) {
+      append_decimal(get_ansi_16_code(index, layer), target_str);
+   }
+   else {
+      target_str += (layer == Layer::Back) ? "48;5;" : "38;5;";
+      append_channel(index, target_str);
+   }
+   target_str += 'm';
+}
+TEST_CASE("insert_palette_color_string()") {
+   moo::ByteBuffer str(32);
+   moo::insert_palette_color_string(196, moo::Layer::Back, moo::ColorMode::Palette256, str);
+   CHECK(str.get_view() == "\x1b[48;5;196m");
+
+   str.clear();
+   moo::insert_palette_color_string(9, moo::Layer::Front, moo::ColorMode::Palette16, str);
+   CHECK(str.get_view() == "\x1b[91m");
+}
+
+
+void moo::append_decimal(
+   const int number,
+   ByteBuffer& target_str
+)
+{
+   if (number >= 0 && number < 256) {
+      append_channel(static_cast<unsigned char>(number), target_str);
+      return;
+   }
+   std::array<char, 12> buffer;
+   const auto result = std::to_chars(buffer.data(), buffer.data() + buffer.size(), number);
+   target_str.append(buffer.data(), static_cast<size_t>(result.ptr - buffer.data()));
+}
+
+
+moo::Painter::Painter(
+   const double color_tolerance,
+   const ColorMode color_mode
+)
+   : m_color_tolerance(color_tolerance)
+   , m_color_mode(color_mode)
+{
+
+}
+
+
 auto moo::Painter::paint(
    const RGB& fg_color,
    const RGB& bg_color,
-   std::wstring& target_str
+   ByteBuffer& target_str
 ) -> void
 {
    paint_layer(fg_color, Layer::Front, target_str);
@@ -34,15 +171,51 @@ auto moo::Painter::paint(
 auto moo::Painter::paint_layer(
    const RGB color,
    const Layer layer,
-   std::wstring& target_str
+   ByteBuffer& target_str
 ) -> void
 {
+   // In the palette modes, the remembered colors are the palette colors that were actually written
+   RGB painted_color = color;
+   unsigned char palette_index = 0;
+   if (m_color_mode != ColorMode::TrueColor) {
+      palette_index = get_palette_index(color, m_color_mode);
+      painted_color = get_palette_color(palette_index);
+   }
+
    RGB& target_color_memory = (layer == Layer::Front) ? m_last_fg_color : m_last_bg_color;
-   if (color != target_color_memory) {
-      insert_color_string(color, layer, target_str);
-      target_color_memory = color;
-      ++m_color_changes;
+   if (painted_color == target_color_memory)
+      return;
+
+   // Only colors that would be written otherwise need the (slower) perceptual check
+   if (m_color_tolerance > 0.0) {
+      OkLab& target_lab_memory = (layer == Layer::Front) ? m_last_fg_lab : m_last_bg_lab;
+      const OkLab lab = get_oklab(painted_color);
+      if (get_oklab_distance(lab, target_lab_memory) <= m_color_tolerance)
+         return;
+      target_lab_memory = lab;
    }
+   if (m_color_mode == ColorMode::TrueColor)
+      insert_color_string(painted_color, layer, target_str);
+   else
+      insert_palette_color_string(palette_index, layer, m_color_mode, target_str);
+   target_color_memory = painted_color;
+   ++m_color_changes;
+}
+TEST_CASE("Painter color tolerance") {
+   using namespace moo;
+   constexpr RGB sky{ 149, 179, 228 };
+   Painter painter(0.02, ColorMode::TrueColor);
+   ByteBuffer str(64);
+   painter.paint_layer(sky, Layer::Back, str);
+   CHECK(painter.get_paint_count() == 1);
+
+   // Barely different colors keep the current one
+   painter.paint_layer(RGB{ 150, 180, 228 }, Layer::Back, str);
+   CHECK(painter.get_paint_count() == 1);
+   CHECK(painter.get_current_color(Layer::Back) == sky);
+
+   painter.paint_layer(RGB{ 55, 108, 48 }, Layer::Back, str);
+   CHECK(painter.get_paint_count() == 2);
 }
 
 
@@ -51,7 +224,49 @@ auto moo::Painter::reset_paint_count() -> void{
 }
 
 
-auto moo::Painter::get_paint_count() -> unsigned int{
+auto moo::Painter::get_paint_count() const -> unsigned int{
    return m_color_changes;
 }
 
+
+// Number of bytes it takes to change to that color
+auto moo::Painter::get_paint_cost(
+   const RGB& color,
+   const Layer layer
+) const -> size_t
+{
+   if (m_color_mode == ColorMode::Palette16)
+      return (get_ansi_16_code(get_palette_index(color, m_color_mode), layer) < 100) ? 5 : 6;
+   if (m_color_mode == ColorMode::Palette256)
+      return 7 + decimal_strings[get_palette_index(color, m_color_mode)].length + 1; // "\x1b[38;5;" + index + "m"
+   const size_t digits = decimal_strings[color.r].length + decimal_strings[color.g].length + decimal_strings[color.b].length;
+   return 7 + digits + 2 + 1; // "\x1b[38;2;" + channels + two semicolons + "m"
+}
+
+
+auto moo::Painter::get_current_color(const Layer layer) const -> RGB{
+   return (layer == Layer::Front) ? m_last_fg_color : m_last_bg_color;
+}
+
+
+// The conversions are the expensive part of is_close(), so they're done once per color
+auto moo::Painter::get_painted_color(const RGB& color) const -> PaintedColor{
+   PaintedColor result{ color, get_quantized_color(color, m_color_mode), {} };
+   if (m_color_tolerance > 0.0)
+      result.lab = get_oklab(result.painted);
+   return result;
+}
+
+
+// Whether painting b over a would be skipped
+auto moo::Painter::is_close(
+   const PaintedColor& a,
+   const PaintedColor& b
+) const -> bool
+{
+   if (a.painted == b.painted)
+      return true;
+   if (m_color_tolerance <= 0.0)
+      return false;
+   return get_oklab_distance(a.lab, b.lab) <= m_color_tolerance;
+}
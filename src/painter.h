@@ -1,6 +1,8 @@
 #pragma once
 
+#include "byte_buffer.h"
 #include "color.h"
+#include "palette.h"
 
 #include <string>
 #include <vector>
@@ -9,22 +11,44 @@ namespace moo {
 
    enum class Layer { Front, Back };
 
+   void insert_color_string(const moo::RGB& rgb, const Layer layer, ByteBuffer& target_str);
    void insert_color_string(const moo::RGB& rgb, const Layer layer, std::wstring& target_str);
+   void insert_palette_color_string(const unsigned char index, const Layer layer, const ColorMode mode, ByteBuffer& target_str);
+   void append_decimal(const int number, ByteBuffer& target_str);
+
+   /// <summary>A color together with what the painter would actually write for it. The OKLab is only
+   /// filled in with a color tolerance.</summary>
+   struct PaintedColor {
+      RGB color;
+      RGB painted;
+      OkLab lab;
+   };
 
    struct Painter {
       using Front = struct {};
       using Back = struct {};
 
       Painter() = default;
-      auto paint(const RGB& fg_color, const RGB& bg_color, std::wstring& target_str) -> void;
-      auto paint_layer(const RGB, const Layer layer, std::wstring& target_str) -> void;
+      Painter(const double color_tolerance, const ColorMode color_mode);
+      auto paint(const RGB& fg_color, const RGB& bg_color, ByteBuffer& target_str) -> void;
+      auto paint_layer(const RGB, const Layer layer, ByteBuffer& target_str) -> void;
       auto reset_paint_count() -> void;
-      auto get_paint_count() -> unsigned int;
+      auto get_paint_count() const -> unsigned int;
+      [[nodiscard]] auto get_paint_cost(const RGB& color, const Layer layer) const -> size_t;
+      [[nodiscard]] auto get_current_color(const Layer layer) const -> RGB;
+      [[nodiscard]] auto get_painted_color(const RGB& color) const -> PaintedColor;
+      [[nodiscard]] auto is_close(const PaintedColor& a, const PaintedColor& b) const -> bool;
 
    private:
       RGB m_last_fg_color{255, 255, 255};
       RGB m_last_bg_color{0, 0, 0};
       unsigned int m_color_changes = 0;
+
+      // Colors closer than this to the current ones are drawn with the current ones. Zero for exact colors
+      double m_color_tolerance = 0.0;
+      ColorMode m_color_mode = ColorMode::TrueColor;
+      OkLab m_last_fg_lab{1.0, 0.0, 0.0};
+      OkLab m_last_bg_lab{0.0, 0.0, 0.0};
    };
 
 }
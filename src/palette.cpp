@@ -0,0 +1,194 @@
+#include "palette.h"
+
+#include <array>
+#include <limits>
+#include <optional>
+
+#include <doctest/doctest.h>
+
+
+namespace {
+
+   constexpr std::array<unsigned char, 6> cube_levels{ 0, 95, 135, 175, 215, 255 };
+
+
+   // The first 16 are the Windows console defaults. The rest is the xterm 6x6x6 cube and the gray ramp
+   [[nodiscard]] constexpr auto get_palette() -> std::array<moo::RGB, 256> {
+      std::array<moo::RGB, 256> palette{ {
+         {12, 12, 12}, {197, 15, 31}, {19, 161, 14}, {193, 156, 0},
+         {0, 55, 218}, {136, 23, 152}, {58, 150, 221}, {204, 204, 204},
+         {118, 118, 118}, {231, 72, 86}, {22, 198, 12}, {249, 241, 165},
+         {59, 120, 255}, {180, 0, 158}, {97, 214, 214}, {242, 242, 242}
+      } };
+      for (int i = 0; i < 216; ++i)
+         palette[16 + i] = { cube_levels[i / 36], cube_levels[(i / 6) % 6], cube_levels[i % 6] };
+      for (int i = 0; i < 24; ++i) {
+         const unsigned char gray = static_cast<unsigned char>(8 + 10 * i);
+         palette[232 + i] = { gray, gray, gray };
+      }
+      return palette;
+   }
+   constexpr std::array<moo::RGB, 256> palette = get_palette();
+
+
+   // The lookup tables have 32 steps per channel. Each entry is the palette color closest (in OKLab) to a
+   // representative of its box. That's spread so that black and white land on themselves
+   constexpr int lut_shift = 3;
+   constexpr int lut_steps = 256 >> lut_shift;
+   using PaletteLut = std::array<unsigned char, lut_steps * lut_steps * lut_steps>;
+
+   [[nodiscard]] auto get_lut_index(const moo::RGB& color) -> size_t {
+      return ((color.r >> lut_shift) * lut_steps + (color.g >> lut_shift)) * lut_steps + (color.b >> lut_shift);
+   }
+
+
+   [[nodiscard]] constexpr auto get_representative(const int step) -> unsigned char {
+      return static_cast<unsigned char>((step << lut_shift) | (step >> (8 - 2 * lut_shift)));
+   }
+   static_assert(get_representative(0) == 0);
+   static_assert(get_representative(lut_steps - 1) == 255);
+
+
+   [[nodiscard]] auto get_lut(
+      const int first_index,
+      const int end_index
+   ) -> PaletteLut
+   {
+      std::array<moo::OkLab, 256> palette_labs;
+      for (int i = first_index; i < end_index; ++i)
+         palette_labs[i] = moo::get_oklab(palette[i]);
+
+      PaletteLut lut;
+      for (int r = 0; r < lut_steps; ++r) {
+         for (int g = 0; g < lut_steps; ++g) {
+            for (int b = 0; b < lut_steps; ++b) {
+               const moo::RGB representative{ get_representative(r), get_representative(g), get_representative(b) };
+               const moo::OkLab representative_lab = moo::get_oklab(representative);
+               double best_distance = std::numeric_limits<double>::max();
+               int best_index = first_index;
+               for (int i = first_index; i < end_index; ++i) {
+                  const double distance = moo::get_oklab_distance(representative_lab, palette_labs[i]);
+                  if (distance < best_distance) {
+                     best_distance = distance;
+                     best_index = i;
+                  }
+               }
+               lut[get_lut_index(representative)] = static_cast<unsigned char>(best_index);
+            }
+         }
+      }
+      return lut;
+   }
+
+
+   // Built on first use, that takes a moment
+   [[nodiscard]] auto get_palette_256_lut() -> const PaletteLut& {
+      // The first 16 colors are left out of the 256 color mode. Terminals disagree on those
+      static const PaletteLut lut = get_lut(16, 256);
+      return lut;
+   }
+
+
+   [[nodiscard]] auto get_palette_16_lut() -> const PaletteLut& {
+      static const PaletteLut lut = get_lut(0, 16);
+      return lut;
+   }
+
+
+   [[nodiscard]] constexpr auto get_cube_level_index(const unsigned char value) -> int {
+      for (int i = 0; i < static_cast<int>(cube_levels.size()); ++i) {
+         if (cube_levels[i] == value)
+            return i;
+      }
+      return -1;
+   }
+   static_assert(get_cube_level_index(0) == 0);
+   static_assert(get_cube_level_index(255) == 5);
+   static_assert(get_cube_level_index(100) == -1);
+
+
+   // Some cube and gray colors share a box of the lookup table, which can only hold one of them. Those are
+   // matched exactly, so quantizing a quantized color gives the same color again
+   [[nodiscard]] auto get_exact_palette_256_index(const moo::RGB& color) -> std::optional<unsigned char> {
+      const int r = get_cube_level_index(color.r);
+      const int g = get_cube_level_index(color.g);
+      const int b = get_cube_level_index(color.b);
+      if (r >= 0 && g >= 0 && b >= 0)
+         return static_cast<unsigned char>(16 + 36 * r + 6 * g + b);
+      const bool is_gray = color.r == color.g && color.g == color.b;
+      if (is_gray && color.r >= 8 && color.r <= 238 && (color.r - 8) % 10 == 0)
+         return static_cast<unsigned char>(232 + (color.r - 8) / 10);
+      return std::nullopt;
+   }
+
+} // namespace {}
+
+
+auto moo::get_color_mode(const std::string_view name) -> ColorMode{
+   if (name == "truecolor")
+      return ColorMode::TrueColor;
+   if (name == "256")
+      return ColorMode::Palette256;
+   if (name == "16")
+      return ColorMode::Palette16;
+   printf("Unknown color mode: %s\n", std::string(name).c_str());
+   std::terminate();
+}
+
+
+// The names of config.toml
+auto moo::get_color_mode_name(const ColorMode mode) -> const char*{
+   switch (mode) {
+   case ColorMode::Palette256: return "256";
+   case ColorMode::Palette16: return "16";
+   default: return "truecolor";
+   }
+}
+
+
+auto moo::get_palette_index(
+   const RGB& color,
+   const ColorMode mode
+) -> unsigned char
+{
+   if (mode == ColorMode::Palette16)
+      return get_palette_16_lut()[get_lut_index(color)];
+   if (const std::optional<unsigned char> exact = get_exact_palette_256_index(color); exact.has_value())
+      return exact.value();
+   return get_palette_256_lut()[get_lut_index(color)];
+}
+
+
+auto moo::get_palette_color(const unsigned char index) -> RGB{
+   return palette[index];
+}
+
+
+auto moo::get_quantized_color(
+   const RGB& color,
+   const ColorMode mode
+) -> RGB
+{
+   if (mode == ColorMode::TrueColor)
+      return color;
+   return get_palette_color(get_palette_index(color, mode));
+}
+TEST_CASE("get_quantized_color()") {
+   using namespace moo;
+   CHECK(get_palette_index(RGB{ 0, 0, 0 }, ColorMode::Palette256) == 16);
+   CHECK(get_palette_index(RGB{ 255, 255, 255 }, ColorMode::Palette256) == 231);
+   CHECK(get_palette_index(RGB{ 250, 10, 20 }, ColorMode::Palette16) == 9);
+
+   // Quantized colors have to stay what they are, the painter quantizes them again
+   for (int i = 16; i < 256; ++i)
+      CHECK(get_palette_index(get_palette_color(static_cast<unsigned char>(i)), ColorMode::Palette256) == i);
+   for (int i = 0; i < 16; ++i)
+      CHECK(get_palette_index(get_palette_color(static_cast<unsigned char>(i)), ColorMode::Palette16) == i);
+
+   constexpr RGB sky{ 149, 179, 228 };
+   CHECK(get_quantized_color(sky, ColorMode::TrueColor) == sky);
+   for (const ColorMode mode : { ColorMode::Palette256, ColorMode::Palette16 }) {
+      const RGB quantized = get_quantized_color(sky, mode);
+      CHECK(get_quantized_color(quantized, mode) == quantized);
+   }
+}
@@ -0,0 +1,18 @@
+#pragma once
+
+#include "color.h"
+
+#include <string_view>
+
+
+namespace moo {
+
+   enum class ColorMode { TrueColor, Palette256, Palette16 };
+
+   [[nodiscard]] auto get_color_mode(const std::string_view name) -> ColorMode;
+   [[nodiscard]] auto get_color_mode_name(const ColorMode mode) -> const char*;
+   [[nodiscard]] auto get_palette_index(const RGB& color, const ColorMode mode) -> unsigned char;
+   [[nodiscard]] auto get_palette_color(const unsigned char index) -> RGB;
+   [[nodiscard]] auto get_quantized_color(const RGB& color, const ColorMode mode) -> RGB;
+
+}
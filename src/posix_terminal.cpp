@@ -0,0 +1,299 @@
+#ifndef _WIN32
+
+#include "terminal.h"
+
+#include <doctest/doctest.h>
+#include <Tracy.hpp>
+
+#include <array>
+#include <cerrno>
+#include <charconv>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <exception>
+#include <string>
+
+#include <poll.h>
+#include <sys/ioctl.h>
+#include <termios.h>
+#include <unistd.h>
+
+
+namespace {
+
+   // Loops because write(2) may take only part of a large frame
+   auto write_all(const std::string_view bytes) -> void {
+      size_t written = 0;
+      while (written < bytes.size()) {
+         const ssize_t result = ::write(STDOUT_FILENO, bytes.data() + written, bytes.size() - written);
+         if (result < 0) {
+            if (errno == EINTR)
+               continue;
+            printf("write() fail.\n");
+            std::terminate();
+         }
+         written += static_cast<size_t>(result);
+      }
+   }
+
+
+   constexpr std::string_view restore_sequence = "\x1b[0m\x1b[?25h\x1b[?1049l";
+
+
+   // What the signal and terminate handlers need to restore the terminal. There's only one terminal at a
+   // time, so this can be global
+   termios restore_termios;
+   volatile std::sig_atomic_t restore_armed = 0;
+   constexpr std::array<int, 3> restored_signals{ SIGINT, SIGTERM, SIGHUP };
+   std::array<struct sigaction, restored_signals.size()> previous_actions;
+   std::terminate_handler previous_terminate_handler = nullptr;
+
+
+   // Only uses async-signal-safe calls, so that it can run in a signal handler
+   auto restore_from_handler() -> void {
+      if (restore_armed == 0)
+         return;
+      restore_armed = 0;
+      [[maybe_unused]] const ssize_t result = ::write(STDOUT_FILENO, restore_sequence.data(), restore_sequence.size());
+      tcsetattr(STDIN_FILENO, TCSAFLUSH, &restore_termios);
+   }
+
+
+   // The default action of the signal then ends the program as if there was no handler
+   void handle_signal(const int signal) {
+      restore_from_handler();
+      std::signal(signal, SIG_DFL);
+      std::raise(signal);
+   }
+
+
+   // The error paths end with std::terminate(), which doesn't unwind to the terminal's destructor
+   [[noreturn]] void handle_terminate() {
+      restore_from_handler();
+      if (previous_terminate_handler != nullptr)
+         previous_terminate_handler();
+      std::abort();
+   }
+
+
+   auto arm_restore(const termios& initial_termios) -> void {
+      restore_termios = initial_termios;
+      restore_armed = 1;
+      struct sigaction action {};
+      action.sa_handler = handle_signal;
+      sigemptyset(&action.sa_mask);
+      for (size_t k = 0; k < restored_signals.size(); ++k)
+         sigaction(restored_signals[k], &action, &previous_actions[k]);
+      previous_terminate_handler = std::set_terminate(handle_terminate);
+   }
+
+
+   auto disarm_restore() -> void {
+      restore_armed = 0;
+      for (size_t k = 0; k < restored_signals.size(); ++k)
+         sigaction(restored_signals[k], &previous_actions[k], nullptr);
+      std::set_terminate(previous_terminate_handler);
+   }
+
+
+   // Arrows are ESC [ A to ESC [ D, or ESC O A to ESC O D in application mode, and count as WASD. Other
+   // special keys are longer sequences that end with a byte from @ to ~, they are ignored. ESC followed by
+   // any other byte is Alt with that key, only an ESC on its own is the key itself.
+   [[nodiscard]] auto parse_input(const std::string_view bytes) -> moo::Input {
+      moo::Input input;
+      for (size_t k = 0; k < bytes.size(); ++k) {
+         char key = bytes[k];
+         if (key == '\x1b' && k + 1 < bytes.size() && bytes[k + 1] != '\x1b') {
+            key = '\0';
+            if (bytes[k + 1] == '[' || bytes[k + 1] == 'O') {
+               size_t end = k + 2;
+               while (end < bytes.size() && (bytes[end] < '@' || bytes[end] > '~'))
+                  ++end;
+               if (end < bytes.size()) {
+                  constexpr std::string_view arrows = "ABCD";
+                  constexpr std::string_view arrow_letters = "wsda";
+                  const size_t arrow = arrows.find(bytes[end]);
+                  if (arrow != std::string_view::npos)
+                     key = arrow_letters[arrow];
+               }
+               k = end;
+            }
+            else
+               ++k;
+         }
+         switch (key) {
+         case '\x1b': input.esc_pressed = true; break;
+         case ' ': input.space_pressed = true; break;
+         case 'a': input.left_pressed = true; break;
+         case 'd': input.right_pressed = true; break;
+         case 'w': input.up_pressed = true; break;
+         case 's': input.down_pressed = true; break;
+         default: break;
+         }
+      }
+      return input;
+   }
+
+
+   // The answer to DSR is ESC [ row ; column R. Keys pressed in the meantime may come before it
+   [[nodiscard]] auto parse_cursor_position(const std::string_view bytes) -> std::optional<moo::LineCoord> {
+      for (size_t end = bytes.find('R'); end != std::string_view::npos; end = bytes.find('R', end + 1)) {
+         const size_t begin = bytes.rfind("\x1b[", end);
+         if (begin == std::string_view::npos)
+            continue;
+         const char* const params_end = bytes.data() + end;
+         int row = 0;
+         int column = 0;
+         const auto [row_end, row_error] = std::from_chars(bytes.data() + begin + 2, params_end, row);
+         if (row_error != std::errc{} || row_end == params_end || *row_end != ';')
+            continue;
+         const auto [column_end, column_error] = std::from_chars(row_end + 1, params_end, column);
+         if (column_error != std::errc{} || column_end != params_end)
+            continue;
+         return moo::LineCoord{ row - 1, column - 1 };
+      }
+      return std::nullopt;
+   }
+
+} // namespace {}
+
+
+struct moo::Terminal::State {
+   termios initial_termios;
+   bool restored = false;
+};
+
+
+auto moo::get_terminal_size() -> std::optional<TerminalSize>{
+   winsize size;
+   if (ioctl(STDOUT_FILENO, TIOCGWINSZ, &size) != 0 || size.ws_row == 0 || size.ws_col == 0)
+      return std::nullopt;
+   return TerminalSize{ size.ws_row, size.ws_col };
+}
+
+
+// Raw mode: no echo, no line buffering and nonblocking reads. Ctrl+C still works, and it or another signal
+// restores the terminal before the program ends. So does std::terminate().
+moo::Terminal::Terminal()
+   : m_state(std::make_unique<State>())
+{
+   if (tcgetattr(STDIN_FILENO, &m_state->initial_termios) != 0) {
+      printf("tcgetattr() fail.\n");
+      std::terminate();
+   }
+   termios raw = m_state->initial_termios;
+   raw.c_iflag &= ~(IXON | ICRNL);
+   raw.c_lflag &= ~(ECHO | ICANON | IEXTEN);
+   raw.c_cc[VMIN] = 0;
+   raw.c_cc[VTIME] = 0;
+   if (tcsetattr(STDIN_FILENO, TCSAFLUSH, &raw) != 0) {
+      printf("tcsetattr() fail.\n");
+      std::terminate();
+   }
+   arm_restore(m_state->initial_termios);
+
+   // Alternate screen and hidden cursor
+   write_all("\x1b[?1049h\x1b[?25l");
+}
+
+
+moo::Terminal::~Terminal() {
+   restore();
+}
+
+
+auto moo::Terminal::write(const std::string_view utf8_str) -> void{
+   ZoneScopedC(0x808080);
+   write_all(utf8_str);
+}
+
+
+auto moo::Terminal::clear_screen() -> void{
+   write_all("\x1b[0m\x1b[2J\x1b[H");
+}
+
+
+auto moo::Terminal::restore() -> void{
+   if (m_state->restored)
+      return;
+   disarm_restore();
+   write_all(restore_sequence);
+   tcsetattr(STDIN_FILENO, TCSAFLUSH, &m_state->initial_termios);
+   m_state->restored = true;
+}
+
+
+// Terminals send key presses, not key states. A key counts as pressed in the frame its bytes arrive, held
+// keys only show with key repeat. No mouse.
+auto moo::Terminal::read_input() -> Input{
+   ZoneScopedC(0x0000ff);
+   // Everything pending is read first, so that no key sequence is split
+   std::string pending;
+   std::array<char, 64> bytes;
+   ssize_t length = 0;
+   while ((length = ::read(STDIN_FILENO, bytes.data(), bytes.size())) > 0)
+      pending.append(bytes.data(), static_cast<size_t>(length));
+   return parse_input(pending);
+}
+
+
+// Terminals answer in order, so the answer to DSR means that everything before has been processed. Keys
+// pressed while waiting are lost
+auto moo::Terminal::get_cursor_position() -> std::optional<LineCoord>{
+   ZoneScopedC(0x0000ff);
+   write_all("\x1b[6n");
+   constexpr std::chrono::milliseconds timeout(1000);
+   const auto deadline = std::chrono::steady_clock::now() + timeout;
+   std::string reply;
+   while (true) {
+      const std::optional<LineCoord> position = parse_cursor_position(reply);
+      if (position.has_value())
+         return position;
+      const auto left = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now());
+      if (left.count() <= 0)
+         return std::nullopt;
+      pollfd input_fd{ STDIN_FILENO, POLLIN, 0 };
+      const int ready = poll(&input_fd, 1, static_cast<int>(left.count()));
+      if (ready < 0 && errno == EINTR)
+         continue;
+      if (ready <= 0)
+         return std::nullopt;
+      std::array<char, 64> bytes;
+      const ssize_t length = ::read(STDIN_FILENO, bytes.data(), bytes.size());
+      if (length > 0)
+         reply.append(bytes.data(), static_cast<size_t>(length));
+   }
+}
+TEST_CASE("parse_cursor_position()") {
+   CHECK(parse_cursor_position("\x1b[12;40R") == moo::LineCoord{ 11, 39 });
+   CHECK(parse_cursor_position("wR\x1b[1;1R") == moo::LineCoord{ 0, 0 });
+   CHECK(parse_cursor_position("\x1b[12;40") == std::nullopt);
+   CHECK(parse_cursor_position("\x1b[1;5A") == std::nullopt);
+}
+TEST_CASE("parse_input()") {
+   CHECK(parse_input("\x1b").esc_pressed);
+   CHECK(parse_input("a\x1b").esc_pressed);
+   CHECK(parse_input("\x1b\x1b").esc_pressed);
+
+   // Arrows in both modes
+   for (const std::string_view arrow : { "\x1b[A", "\x1bOA" }) {
+      const moo::Input input = parse_input(arrow);
+      CHECK(input.up_pressed);
+      CHECK_FALSE(input.esc_pressed);
+   }
+   CHECK(parse_input("\x1b[1;5C").right_pressed);
+
+   // Alt+key, other special keys and uppercase letters are none of the game's keys
+   for (const std::string_view bytes : { "\x1bx", "\x1b[3~", "\x1b[15~", "D", "\x1b[" }) {
+      const moo::Input input = parse_input(bytes);
+      CHECK_FALSE(input.esc_pressed);
+      CHECK_FALSE(input.left_pressed);
+      CHECK_FALSE(input.right_pressed);
+   }
+   CHECK(parse_input(" s").space_pressed);
+   CHECK(parse_input(" s").down_pressed);
+}
+
+#endif // _WIN32
@@ -0,0 +1,93 @@
+#include "resolution_scaler.h"
+
+#include <algorithm>
+
+#include <doctest/doctest.h>
+
+
+namespace {
+
+   // Slow measurements in a row needed for getting coarser
+   constexpr int coarser_hold = 2;
+   constexpr int initial_finer_hold = 3;
+   constexpr int max_finer_hold = 60;
+
+   // Above the target by this factor counts as fast. Going finer costs more than that, so the hold time
+   // matters more.
+   constexpr double fast_factor = 1.5;
+
+} // namespace {}
+
+
+moo::ResolutionScaler::ResolutionScaler(
+   const double target_fps,
+   const int max_scale
+)
+   : m_target_fps(target_fps)
+   , m_max_scale(max_scale)
+   , m_finer_hold(initial_finer_hold)
+{
+
+}
+
+
+auto moo::ResolutionScaler::update(const double fps) -> void{
+   const bool is_slow = fps < m_target_fps;
+   const bool is_fast = fps > fast_factor * m_target_fps;
+   m_slow_count = is_slow ? m_slow_count + 1 : 0;
+   m_fast_count = is_fast ? m_fast_count + 1 : 0;
+
+   if (m_slow_count >= coarser_hold && m_scale < m_max_scale) {
+      ++m_scale;
+      m_finer_hold = std::min(2 * m_finer_hold, max_finer_hold);
+      m_slow_count = 0;
+   }
+   else if (m_fast_count >= m_finer_hold && m_scale > 1) {
+      --m_scale;
+      m_fast_count = 0;
+   }
+}
+
+
+auto moo::ResolutionScaler::get_scale() const -> int{
+   return m_scale;
+}
+
+
+TEST_CASE("ResolutionScaler") {
+   using namespace moo;
+   ResolutionScaler scaler(60.0, 3);
+
+   // One slow measurement isn't enough
+   scaler.update(40.0);
+   scaler.update(70.0);
+   scaler.update(40.0);
+   CHECK(scaler.get_scale() == 1);
+   scaler.update(40.0);
+   CHECK(scaler.get_scale() == 2);
+
+   // Not faster than wanted, but fast enough: stays
+   for (int i = 0; i < 20; ++i)
+      scaler.update(80.0);
+   CHECK(scaler.get_scale() == 2);
+
+   // Getting finer waits longer every time it had to get coarser
+   for (int i = 0; i < 5; ++i)
+      scaler.update(100.0);
+   CHECK(scaler.get_scale() == 2);
+   scaler.update(100.0);
+   CHECK(scaler.get_scale() == 1);
+   scaler.update(40.0);
+   scaler.update(40.0);
+   CHECK(scaler.get_scale() == 2);
+   for (int i = 0; i < 11; ++i)
+      scaler.update(100.0);
+   CHECK(scaler.get_scale() == 2);
+   scaler.update(100.0);
+   CHECK(scaler.get_scale() == 1);
+
+   // Never coarser than the maximum
+   for (int i = 0; i < 20; ++i)
+      scaler.update(10.0);
+   CHECK(scaler.get_scale() == 3);
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+
+namespace moo {
+
+   /// <summary>Chooses the internal resolution from a measured frame rate: a scale of n means that every
+   /// n x n block of cells shows one internally rendered cell. Gets coarser when the frame rate stays below the
+   /// target and finer when it stays well above it. Every time it has to get coarser, it waits twice as long
+   /// before trying finer again, so it settles instead of going back and forth.</summary>
+   struct ResolutionScaler {
+      ResolutionScaler(const double target_fps, const int max_scale);
+
+      // With every new FPS measurement
+      auto update(const double fps) -> void;
+      [[nodiscard]] auto get_scale() const -> int;
+
+   private:
+      double m_target_fps = 0.0;
+      int m_max_scale = 1;
+      int m_scale = 1;
+      int m_slow_count = 0;
+      int m_fast_count = 0;
+      int m_finer_hold = 0; // Fast measurements in a row needed for getting finer
+   };
+
+}
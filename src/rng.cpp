@@ -12,3 +12,8 @@ namespace {
 auto moo::get_rng() -> std::mt19937_64&{
    return static_rng;
 }
+
+
+auto moo::set_rng_seed(const std::uint64_t seed) -> void{
+   static_rng.seed(seed);
+}
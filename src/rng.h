@@ -1,9 +1,13 @@
 #pragma once
 
+#include <cstdint>
 #include <random>
 
 namespace moo {
 
    auto get_rng()->std::mt19937_64&;
 
+   // Makes everything random repeat, like for headless runs. Seeded from the clock otherwise
+   auto set_rng_seed(const std::uint64_t seed) -> void;
+
 }
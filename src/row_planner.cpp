@@ -0,0 +1,164 @@
+﻿#include "row_planner.h"
+
+#include <doctest/doctest.h>
+#include <Tracy.hpp>
+
+#include <limits>
+
+
+namespace {
+
+   // Flipping can only pay off where a color is wanted in the other layer than it currently is in. This is
+   // judged by drawing the cells as they are - that misses a few chances but is cheap
+   [[nodiscard]] auto has_swapped_colors(
+      const std::span<const moo::Cell> cells,
+      const moo::Painter& painter
+   ) -> bool
+   {
+      moo::RGB fg = painter.get_current_color(moo::Layer::Front);
+      moo::RGB bg = painter.get_current_color(moo::Layer::Back);
+      for (const moo::Cell& cell : cells) {
+         if (cell.bg != bg && cell.bg == fg)
+            return true;
+
+         // The background of a full block doesn't show, so as a space it needs one change instead of two
+         if (cell.glyph == L'█' && cell.bg != bg && cell.fg != fg)
+            return true;
+         bg = cell.bg;
+         if (!cell.has_fg())
+            continue;
+         if (cell.fg != fg && cell.fg == bg)
+            return true;
+         fg = cell.fg;
+      }
+      return false;
+   }
+
+} // namespace {}
+
+
+/// <summary>Dynamic programming over the row with the two orientations as states. With the "don't care"
+/// foreground of spaces, the colors of a state depend a bit on history - only the cheapest way into each
+/// state is kept, which is good enough.</summary>
+auto moo::RowPlanner::plan(
+   const std::span<const Cell> cells,
+   const Painter& painter
+) -> std::span<const Cell>
+{
+   ZoneScoped;
+   if (!has_swapped_colors(cells, painter))
+      return cells;
+   m_candidates.resize(cells.size());
+   m_steps.resize(cells.size());
+   m_planned.resize(cells.size());
+   if (cells.empty())
+      return m_planned;
+
+   for (size_t j = 0; j < cells.size(); ++j) {
+      const std::optional<Cell> flipped = get_flipped_cell(cells[j]);
+      m_candidates[j][0] = {
+         cells[j],
+         painter.get_paint_cost(cells[j].fg, Layer::Front),
+         painter.get_paint_cost(cells[j].bg, Layer::Back),
+         painter.get_painted_color(cells[j].fg),
+         painter.get_painted_color(cells[j].bg)
+      };
+      if (!flipped.has_value()) {
+         m_candidates[j][1] = m_candidates[j][0];
+         continue;
+      }
+
+      // Flipping only swaps the colors around, so their costs and conversions are known already
+      const Candidate& original = m_candidates[j][0];
+      const auto is_original_bg = [&](const RGB& color) {
+         return color == original.cell.bg;
+      };
+      m_candidates[j][1] = {
+         flipped.value(),
+         is_original_bg(flipped->fg) ? original.bg_cost : original.fg_cost,
+         is_original_bg(flipped->bg) ? original.bg_cost : original.fg_cost,
+         is_original_bg(flipped->fg) ? original.painted_bg : original.painted_fg,
+         is_original_bg(flipped->bg) ? original.painted_bg : original.painted_fg
+      };
+   }
+
+   // Colors that don't need to change stay as they are, so the painter state carries over
+   const auto get_next_step = [&](const Step& previous, const Candidate& candidate, const int previous_orientation) {
+      Step step{ previous.cost, previous.fg, previous.bg, previous_orientation };
+      if (candidate.cell.bg != step.bg.color && !painter.is_close(step.bg, candidate.painted_bg)) {
+         step.cost += candidate.bg_cost;
+         step.bg = candidate.painted_bg;
+      }
+      if (candidate.cell.has_fg() && candidate.cell.fg != step.fg.color && !painter.is_close(step.fg, candidate.painted_fg)) {
+         step.cost += candidate.fg_cost;
+         step.fg = candidate.painted_fg;
+      }
+      return step;
+   };
+
+   constexpr size_t unreachable = std::numeric_limits<size_t>::max();
+   const Step start{
+      0,
+      painter.get_painted_color(painter.get_current_color(Layer::Front)),
+      painter.get_painted_color(painter.get_current_color(Layer::Back)),
+      0
+   };
+   for (size_t j = 0; j < cells.size(); ++j) {
+      // Runs of the same cell are common. Staying in an orientation costs nothing there, and switching is
+      // never cheaper than having been in that orientation in the cell before
+      if (j > 0 && cells[j] == cells[j - 1]) {
+         m_steps[j] = { m_steps[j - 1][0], m_steps[j - 1][1] };
+         m_steps[j][0].previous_orientation = 0;
+         m_steps[j][1].previous_orientation = 1;
+         continue;
+      }
+
+      // Complements are never the glyph itself
+      const bool flippable = m_candidates[j][1].cell.glyph != cells[j].glyph;
+      for (int orientation = 0; orientation < 2; ++orientation) {
+         Step& step = m_steps[j][orientation];
+         step.cost = unreachable;
+         if (orientation == 1 && !flippable)
+            continue;
+         const Candidate& candidate = m_candidates[j][orientation];
+         if (j == 0) {
+            step = get_next_step(start, candidate, 0);
+            continue;
+         }
+         for (int previous = 0; previous < 2; ++previous) {
+            const Step& previous_step = m_steps[j - 1][previous];
+            if (previous_step.cost == unreachable)
+               continue;
+            const Step next_step = get_next_step(previous_step, candidate, previous);
+            if (next_step.cost < step.cost)
+               step = next_step;
+         }
+      }
+   }
+
+   // Walk back from the cheaper end. Ties go to the original orientation
+   const std::array<Step, 2>& last_steps = m_steps.back();
+   int orientation = (last_steps[1].cost < last_steps[0].cost) ? 1 : 0;
+   for (size_t j = cells.size(); j-- > 0; ) {
+      m_planned[j] = m_candidates[j][orientation].cell;
+      orientation = m_steps[j][orientation].previous_orientation;
+   }
+   return m_planned;
+}
+TEST_CASE("RowPlanner") {
+   using namespace moo;
+   constexpr RGB a{ 10, 10, 10 };
+   constexpr RGB b{ 200, 200, 200 };
+   Painter painter;
+   ByteBuffer str(64);
+   painter.paint(a, b, str);
+
+   // Drawn as is, the second cell would need two color changes
+   const std::array<Cell, 2> cells{ { { L'▀', a, b }, { L'▀', b, a } } };
+   RowPlanner planner;
+   const std::span<const Cell> planned = planner.plan(cells, painter);
+   CHECK(planned[0].glyph == L'▀');
+   CHECK(planned[1].glyph == L'▄');
+   CHECK(planned[1].fg == a);
+   CHECK(planned[1].bg == b);
+}
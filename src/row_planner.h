@@ -0,0 +1,96 @@
+﻿#pragma once
+
+#include "cell.h"
+#include "painter.h"
+
+#include <array>
+#include <optional>
+#include <span>
+#include <vector>
+
+
+namespace moo {
+
+   [[nodiscard]] constexpr auto get_complement_glyph(const wchar_t glyph) -> std::optional<wchar_t>;
+   [[nodiscard]] constexpr auto get_flipped_cell(const Cell& cell) -> std::optional<Cell>;
+
+   /// <summary>Every two-color cell can be drawn as its glyph with fg=A, bg=B or as the complementary glyph
+   /// with fg=B, bg=A. This picks the orientation of every cell in a row so that the fewest bytes are spent
+   /// on color changes, starting from the current painter colors.</summary>
+   struct RowPlanner {
+      [[nodiscard]] auto plan(const std::span<const Cell> cells, const Painter& painter) -> std::span<const Cell>;
+
+   private:
+      struct Candidate {
+         Cell cell;
+         size_t fg_cost = 0;
+         size_t bg_cost = 0;
+         PaintedColor painted_fg;
+         PaintedColor painted_bg;
+      };
+      struct Step {
+         size_t cost = 0;
+         PaintedColor fg;
+         PaintedColor bg;
+         int previous_orientation = 0;
+      };
+      std::vector<std::array<Candidate, 2>> m_candidates;
+      std::vector<std::array<Step, 2>> m_steps;
+      std::vector<Cell> m_planned;
+   };
+
+}
+
+
+namespace moo::detail {
+
+   constexpr wchar_t block_glyphs_begin = L'▀';
+
+   [[nodiscard]] constexpr auto get_block_complements() -> std::array<wchar_t, 32> {
+      constexpr std::array<std::pair<wchar_t, wchar_t>, 7> complements{ {
+         { L'▀', L'▄' }, // upper and lower half
+         { L'▌', L'▐' }, // left and right half
+         { L'▘', L'▟' },
+         { L'▝', L'▙' },
+         { L'▖', L'▜' },
+         { L'▗', L'▛' },
+         { L'▚', L'▞' } // diagonals
+      } };
+      std::array<wchar_t, 32> result{};
+      for (const auto& [a, b] : complements) {
+         result[a - block_glyphs_begin] = b;
+         result[b - block_glyphs_begin] = a;
+      }
+      return result;
+   }
+   constexpr std::array<wchar_t, 32> block_complements = get_block_complements();
+
+}
+
+
+constexpr auto moo::get_complement_glyph(const wchar_t glyph) -> std::optional<wchar_t> {
+   if (glyph == L' ')
+      return L'█';
+   if (glyph == L'█')
+      return L' ';
+   const unsigned int block_index = static_cast<unsigned int>(glyph - detail::block_glyphs_begin);
+   if (block_index >= detail::block_complements.size() || detail::block_complements[block_index] == 0)
+      return std::nullopt;
+   return detail::block_complements[block_index];
+}
+static_assert(moo::get_complement_glyph(L'▄') == L'▀');
+static_assert(moo::get_complement_glyph(L'▞') == L'▚');
+static_assert(moo::get_complement_glyph(L'x') == std::nullopt);
+
+
+constexpr auto moo::get_flipped_cell(const Cell& cell) -> std::optional<Cell> {
+   const std::optional<wchar_t> complement = get_complement_glyph(cell.glyph);
+   if (!complement.has_value())
+      return std::nullopt;
+
+   // A space flips into a full block. The background is set to the same color so nothing can shine through
+   if (!cell.has_fg())
+      return Cell{ complement.value(), cell.bg, cell.bg };
+   return Cell{ complement.value(), cell.bg, cell.fg };
+}
+static_assert(moo::get_flipped_cell({ L'▀', {1, 1, 1}, {2, 2, 2} }) == moo::Cell{ L'▄', {2, 2, 2}, {1, 1, 1} });
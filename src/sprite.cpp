@@ -0,0 +1,162 @@
+#include "sprite.h"
+
+#include "blend.h"
+
+#include <functional>
+
+#include <doctest/doctest.h>
+
+
+moo::Sprite::Sprite(
+   const int width,
+   const int height,
+   const std::vector<RGB>& pixels
+)
+   : m_width(width)
+   , m_height(height)
+{
+   for (int i = 0; i < height; ++i) {
+      int j = 0;
+      while (j < width) {
+         const RGB* row = &pixels[static_cast<size_t>(i) * width];
+         if (row[j].is_invisible()) {
+            ++j;
+            continue;
+         }
+         SpriteSpan span{ i, j, j, m_pixels.size() };
+         for (; j < width && row[j].is_visible(); ++j)
+            m_pixels.emplace_back(row[j]);
+         span.end_j = j;
+         m_spans.emplace_back(span);
+      }
+   }
+}
+
+
+moo::SpriteCache::SpriteCache(const size_t max_pixels)
+   : m_max_pixels(max_pixels)
+{
+
+}
+
+
+auto moo::SpriteCache::KeyHash::operator()(const Key& key) const -> size_t{
+   return std::hash<const Sprite*>{}(key.sprite) ^ (std::hash<int>{}(key.fade_factor) << 1);
+}
+
+
+// A factor of 0 doesn't fade, that's the sprite itself
+auto moo::SpriteCache::get_faded(
+   const Sprite& sprite,
+   const int fade_factor
+) -> const Sprite&
+{
+   if (fade_factor == 0)
+      return sprite;
+   const Key key{ &sprite, fade_factor };
+   if (const auto found = m_index.find(key); found != m_index.end()) {
+      m_entries.splice(m_entries.begin(), m_entries, found->second);
+      return found->second->sprite;
+   }
+
+   Sprite faded = sprite;
+   for (RGB& pixel : faded.m_pixels)
+      pixel = get_fixed_color_mix(pixel, RGB{ 0, 0, 0 }, fade_factor);
+   m_pixel_count += faded.m_pixels.size();
+   m_entries.push_front({ key, std::move(faded) });
+   m_index.emplace(key, m_entries.begin());
+   return m_entries.front().sprite;
+}
+
+
+// The most recently used one always stays, even if it's too large by itself
+auto moo::SpriteCache::trim() -> void{
+   while (m_pixel_count > m_max_pixels && m_entries.size() > 1) {
+      const Entry& oldest = m_entries.back();
+      m_pixel_count -= oldest.sprite.m_pixels.size();
+      m_index.erase(oldest.key);
+      m_entries.pop_back();
+   }
+}
+
+
+auto moo::SpriteCache::get_variant_count() const -> size_t{
+   return m_entries.size();
+}
+
+
+auto moo::SpriteCache::get_pixel_count() const -> size_t{
+   return m_pixel_count;
+}
+
+
+TEST_CASE("Sprite") {
+   using namespace moo;
+   constexpr RGB x{ 1, 2, 3 };
+   constexpr RGB y{ 4, 5, 6 };
+   constexpr RGB o{};
+   const std::vector<RGB> pixels{
+      o, x, y, o,
+      o, o, o, o,
+      x, o, y, x
+   };
+   const Sprite sprite(4, 3, pixels);
+   REQUIRE(sprite.m_spans.size() == 3);
+   CHECK(sprite.m_spans[0].begin_j == 1);
+   CHECK(sprite.m_spans[0].end_j == 3);
+   CHECK(sprite.m_spans[2].i == 2);
+   CHECK(sprite.m_pixels == std::vector<RGB>{ x, y, x, y, x });
+
+   // Hanging over the top left corner of the screen, the same pixels as checking every one of them
+   const PixelCoord top_left{ -2, -1 };
+   std::vector<std::pair<PixelCoord, RGB>> drawn;
+   sprite.for_each_span(top_left, [&](const PixelCoord& start, const std::span<const RGB> span_pixels) {
+      for (size_t k = 0; k < span_pixels.size(); ++k)
+         drawn.push_back({ start + PixelCoord{ 0, static_cast<int>(k) }, span_pixels[k] });
+   });
+   std::vector<std::pair<PixelCoord, RGB>> expected;
+   for (int i = 0; i < 3; ++i) {
+      for (int j = 0; j < 4; ++j) {
+         const PixelCoord pos = top_left + PixelCoord{ i, j };
+         const RGB& color = pixels[static_cast<size_t>(i) * 4 + j];
+         if (color.is_visible() && is_on_screen(pos))
+            expected.push_back({ pos, color });
+      }
+   }
+   CHECK(drawn == expected);
+
+   // Clipped to rows, like drawing in bands
+   std::vector<std::pair<PixelCoord, RGB>> banded;
+   for (const int begin_i : { -1, 0, 1 }) {
+      sprite.for_each_span(top_left, begin_i, begin_i + 1, [&](const PixelCoord& start, const std::span<const RGB> span_pixels) {
+         for (size_t k = 0; k < span_pixels.size(); ++k)
+            banded.push_back({ start + PixelCoord{ 0, static_cast<int>(k) }, span_pixels[k] });
+      });
+   }
+   CHECK(banded == expected);
+}
+
+
+TEST_CASE("SpriteCache") {
+   using namespace moo;
+   const Sprite a(2, 1, { RGB{ 200, 100, 0 }, RGB{ 10, 0, 0 } });
+   const Sprite b(3, 1, { RGB{ 1, 1, 1 }, RGB{ 2, 2, 2 }, RGB{ 3, 3, 3 } });
+   SpriteCache cache(5);
+
+   CHECK(&cache.get_faded(a, 0) == &a);
+   const Sprite& faded = cache.get_faded(a, 128);
+   CHECK(faded.m_pixels == std::vector<RGB>{ get_fixed_color_mix(RGB{ 200, 100, 0 }, RGB{}, 128), get_fixed_color_mix(RGB{ 10, 0, 0 }, RGB{}, 128) });
+   CHECK(&cache.get_faded(a, 128) == &faded);
+   CHECK(cache.get_variant_count() == 1);
+
+   // b fits next to a, a second variant of b doesn't. Using a again makes the first variant of b the least
+   // recently used one, so that goes. But only when trimming.
+   static_cast<void>(cache.get_faded(b, 64));
+   CHECK(cache.get_pixel_count() == 5);
+   static_cast<void>(cache.get_faded(a, 128));
+   static_cast<void>(cache.get_faded(b, 32));
+   CHECK(cache.get_variant_count() == 3);
+   cache.trim();
+   CHECK(cache.get_variant_count() == 2);
+   CHECK(cache.get_pixel_count() == 5);
+}
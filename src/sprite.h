@@ -0,0 +1,114 @@
+#pragma once
+
+#include "cc.h"
+#include "color.h"
+
+#include <algorithm>
+#include <list>
+#include <optional>
+#include <span>
+#include <unordered_map>
+#include <vector>
+
+
+namespace moo {
+
+   // A run of visible pixels in one row of a sprite
+   struct SpriteSpan {
+      int i = 0;
+      int begin_j = 0;
+      int end_j = 0;
+      size_t first_pixel = 0;
+   };
+
+   /// <summary>An image compiled into the horizontal spans of its visible pixels. Drawing it doesn't look at
+   /// transparent pixels and clips whole spans against the screen instead of checking every pixel.</summary>
+   struct Sprite {
+      Sprite(const int width, const int height, const std::vector<RGB>& pixels);
+
+      template<class T>
+      [[nodiscard]] constexpr auto get_dim() const -> T {
+         return { m_height, m_width };
+      }
+
+      // Calls fun(start, pixels) for the on-screen part of every span
+      template<class Fun>
+      auto for_each_span(const PixelCoord& top_left, const Fun& fun) const -> void;
+
+      // Only the spans in the pixel rows [begin_i, end_i)
+      template<class Fun>
+      auto for_each_span(const PixelCoord& top_left, const int begin_i, const int end_i, const Fun& fun) const -> void;
+
+      int m_width = 0;
+      int m_height = 0;
+      std::vector<SpriteSpan> m_spans;
+      std::vector<RGB> m_pixels;
+   };
+
+   /// <summary>Faded copies of sprites, so that fading costs nothing per frame. Holds at most max_pixels
+   /// pixels, the least recently used variants get evicted first, but only by trim(). Returned sprites
+   /// stay valid until then, so a frame can fetch all of its variants before drawing them in parallel.</summary>
+   struct SpriteCache {
+      explicit SpriteCache(const size_t max_pixels);
+      [[nodiscard]] auto get_faded(const Sprite& sprite, const int fade_factor) -> const Sprite&;
+      auto trim() -> void;
+      [[nodiscard]] auto get_variant_count() const -> size_t;
+      [[nodiscard]] auto get_pixel_count() const -> size_t;
+
+   private:
+      struct Key {
+         const Sprite* sprite = nullptr;
+         int fade_factor = 0;
+         auto operator==(const Key& other) const -> bool = default;
+      };
+      struct KeyHash {
+         auto operator()(const Key& key) const -> size_t;
+      };
+      struct Entry {
+         Key key;
+         Sprite sprite;
+      };
+
+      size_t m_max_pixels = 0;
+      size_t m_pixel_count = 0;
+      std::list<Entry> m_entries; // Most recently used first
+      std::unordered_map<Key, std::list<Entry>::iterator, KeyHash> m_index;
+   };
+
+}
+
+
+template<class Fun>
+auto moo::Sprite::for_each_span(
+   const PixelCoord& top_left,
+   const Fun& fun
+) const -> void
+{
+   for_each_span(top_left, 0, 2 * static_rows, fun);
+}
+
+
+template<class Fun>
+auto moo::Sprite::for_each_span(
+   const PixelCoord& top_left,
+   const int begin_i,
+   const int end_i,
+   const Fun& fun
+) const -> void
+{
+   const int clip_begin_i = std::max(begin_i, 0);
+   const int clip_end_i = std::min(end_i, 2 * static_rows);
+   const int screen_width = 2 * static_columns;
+   for (const SpriteSpan& span : m_spans) {
+      const int i = top_left.i + span.i;
+      if (i < clip_begin_i || i >= clip_end_i)
+         continue;
+      const int span_begin_j = top_left.j + span.begin_j;
+      const int begin_j = std::max(span_begin_j, 0);
+      const int end_j = std::min(top_left.j + span.end_j, screen_width);
+      if (begin_j >= end_j)
+         continue;
+      const RGB* first = &m_pixels[span.first_pixel + (begin_j - span_begin_j)];
+      fun(PixelCoord{ i, begin_j }, std::span<const RGB>(first, static_cast<size_t>(end_j - begin_j)));
+   }
+}
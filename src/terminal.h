@@ -0,0 +1,56 @@
+#pragma once
+
+#include "cc.h"
+#include "screencoord.h"
+
+#include <memory>
+#include <optional>
+#include <string_view>
+
+
+namespace moo {
+
+   struct TerminalSize {
+      int rows = 0;
+      int columns = 0;
+   };
+
+   [[nodiscard]] auto get_terminal_size() -> std::optional<TerminalSize>;
+
+   /// <summary>Keys and mouse, read once per frame. The mouse position is in screen coordinates, where the
+   /// terminal can tell it.</summary>
+   struct Input {
+      bool esc_pressed = false;
+      bool space_pressed = false;
+      bool lmb_pressed = false;
+      bool left_pressed = false;
+      bool right_pressed = false;
+      bool up_pressed = false;
+      bool down_pressed = false;
+      std::optional<ScreenCoord> mouse_pos;
+   };
+
+   /// <summary>The terminal the frames get written to. Implemented with the console API in win_terminal.cpp
+   /// and with termios in posix_terminal.cpp, only one of them is compiled. Construction puts the terminal
+   /// into the mode the game needs, restore() (or destruction) brings back the previous one.</summary>
+   struct Terminal {
+      Terminal();
+      ~Terminal();
+      Terminal(const Terminal& copy) = delete;
+      Terminal& operator=(const Terminal& copy) = delete;
+
+      auto write(const std::string_view utf8_str) -> void;
+      auto clear_screen() -> void;
+      auto restore() -> void;
+      [[nodiscard]] auto read_input() -> Input;
+
+      // Only returns once the terminal has processed everything written before. Empty if the terminal
+      // doesn't tell
+      [[nodiscard]] auto get_cursor_position() -> std::optional<LineCoord>;
+
+   private:
+      struct State;
+      std::unique_ptr<State> m_state;
+   };
+
+}
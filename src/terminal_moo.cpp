@@ -1,9 +1,21 @@
 #define DOCTEST_CONFIG_IMPLEMENT
 #include <doctest/doctest.h>
 
+#include "benchmark.h"
+#include "calibration.h"
 #include "config.h"
 #include "game.h"
+#include "rng.h"
 #include "screen_size.h"
+#include "terminal.h"
+
+#ifdef _WIN32
+#include "win_api_helper.h"
+#endif
+
+#include <charconv>
+#include <filesystem>
+#include <numeric>
 
 auto run_doctest() -> std::optional<int> {
    doctest::Context context;
@@ -14,6 +26,7 @@ auto run_doctest() -> std::optional<int> {
 }
 
 
+#ifdef _WIN32
 void run_intro(
    const std::vector<CHAR_INFO>& console_buffer,
    HANDLE& output_handle
@@ -39,9 +52,47 @@ void run_intro(
       std::this_thread::sleep_for(std::chrono::milliseconds(10));
    }
 }
+#endif // _WIN32
+
+
+auto get_frame_count(const std::string_view str) -> int {
+   int frame_count = 0;
+   const auto [end, error] = std::from_chars(str.data(), str.data() + str.size(), frame_count);
+   if (error != std::errc{} || end != str.data() + str.size() || frame_count <= 0) {
+      printf("Not a frame count: %s\n", std::string(str).c_str());
+      std::terminate();
+   }
+   return frame_count;
+}
+
+
+/// <summary>Runs the game without a console: frames get captured in memory and optionally dumped. Uses the
+/// default screen size and always the same seed, so that runs can be compared frame by frame.</summary>
+void run_headless(
+   const int frame_count,
+   const std::optional<std::filesystem::path>& dump_directory
+) {
+   constexpr std::uint64_t headless_seed = 0;
+   moo::set_rng_seed(headless_seed);
+   moo::HeadlessTarget target(dump_directory);
+   moo::game game_instance(&target);
+   const auto start = std::chrono::steady_clock::now();
+   game_instance.run_headless(frame_count);
+   const std::chrono::duration<double, std::milli> duration = std::chrono::steady_clock::now() - start;
+
+   const std::vector<size_t>& frame_sizes = target.get_frame_sizes();
+   const size_t total_bytes = std::accumulate(frame_sizes.begin(), frame_sizes.end(), size_t{ 0 });
+   const double measured_frames = static_cast<double>(std::max<size_t>(frame_sizes.size(), 1));
+   printf(
+      "%zu frames, %.2f ms and %.0f bytes per frame\n",
+      frame_sizes.size(),
+      duration.count() / measured_frames,
+      total_bytes / measured_frames
+   );
+}
 
 
-int main() {
+int main(int argc, char* argv[]) {
    {
 #ifdef _DEBUG
       const std::optional<int> doctest_result = run_doctest();
@@ -51,21 +102,59 @@ int main() {
    }
 
    moo::setup_config();
+   if (argc > 1 && std::string_view(argv[1]) == "--benchmark") {
+      moo::run_benchmarks();
+      return 0;
+   }
+   if (argc > 3 && std::string_view(argv[1]) == "--throughput") {
+      moo::run_throughput_benchmark(moo::get_throughput_sink(argv[2]), argv[3]);
+      return 0;
+   }
+   if (argc > 2 && std::string_view(argv[1]) == "--headless") {
+      std::optional<std::filesystem::path> dump_directory;
+      if (argc > 3)
+         dump_directory = argv[3];
+      run_headless(get_frame_count(argv[2]), dump_directory);
+      return 0;
+   }
 
-   HANDLE output_handle = GetStdHandle(STD_OUTPUT_HANDLE);
-   CONSOLE_SCREEN_BUFFER_INFO csbi;
-   if (GetConsoleScreenBufferInfo(output_handle, &csbi) == 0)
+   const std::optional<moo::TerminalSize> terminal_size = moo::get_terminal_size();
+   if (!terminal_size.has_value())
       return 1;
-   const int columns = csbi.srWindow.Right - csbi.srWindow.Left + 1;
-   const int rows = csbi.srWindow.Bottom - csbi.srWindow.Top + 1;
-   moo::update_screen_size(rows, columns);
-   moo::game game_instance;
-   {
-      const auto console_buffer = moo::get_console_buffer();
-      if(console_buffer.has_value())
-         run_intro(console_buffer.value(), output_handle);
+   moo::update_screen_size(terminal_size->rows, terminal_size->columns);
+   if (argc > 1 && std::string_view(argv[1]) == "--calibrate") {
+      const std::optional<moo::Calibration> calibration = moo::calibrate_encoding(false);
+      if (!calibration.has_value()) {
+         printf("The terminal doesn't answer cursor position queries, so it can't be timed.\n");
+         return 1;
+      }
+      printf(
+         "%.4f us per byte, %.4f us per color change, %.4f us per cursor move\n",
+         calibration->costs.byte_us, calibration->costs.color_change_us, calibration->costs.cursor_move_us
+      );
+      printf("REP (repeat) %s\n", calibration->costs.supports_repeat ? "works" : "is not supported");
+      printf(
+         "delta_frames = %s, compress_runs = %s, color_mode = %s\n",
+         calibration->settings.delta_frames ? "true" : "false",
+         calibration->settings.compress_runs ? "true" : "false",
+         moo::get_color_mode_name(calibration->settings.color_mode)
+      );
+      return 0;
    }
-   game_instance.run();
 
+   // The intro fades out what was on the console before, that needs the console API. The calibration has
+   // to happen before the game sets up its frame encoder.
+#ifdef _WIN32
+   HANDLE output_handle = GetStdHandle(STD_OUTPUT_HANDLE);
+   const auto console_buffer = moo::get_console_buffer();
+#endif // _WIN32
+   if (moo::get_config().calibrate)
+      moo::calibrate_encoding(true);
+   moo::game game_instance;
+#ifdef _WIN32
+   if (console_buffer.has_value())
+      run_intro(console_buffer.value(), output_handle);
+#endif // _WIN32
+   game_instance.run();
    return 0;
 }
@@ -0,0 +1,106 @@
+#include "thread_pool.h"
+
+#include <algorithm>
+#include <atomic>
+
+#include <doctest/doctest.h>
+
+
+moo::ThreadPool::ThreadPool(const int worker_count) {
+   m_threads.reserve(worker_count);
+   for (int i = 0; i < worker_count; ++i)
+      m_threads.emplace_back([this]() {work(); });
+}
+
+
+moo::ThreadPool::~ThreadPool() {
+   {
+      const std::lock_guard lock(m_mutex);
+      m_stopping = true;
+   }
+   m_wake.notify_all();
+   m_threads.clear();
+}
+
+
+auto moo::ThreadPool::run(
+   const int task_count,
+   const std::function<void(int)>& task
+) -> void
+{
+   if (task_count <= 0)
+      return;
+   {
+      const std::lock_guard lock(m_mutex);
+      m_task = &task;
+      m_task_count = task_count;
+      m_next_task = 0;
+      m_tasks_left = task_count;
+      ++m_generation;
+   }
+   m_wake.notify_all();
+   do_tasks();
+
+   std::unique_lock lock(m_mutex);
+   m_done.wait(lock, [&]() {return m_tasks_left == 0; });
+}
+
+
+auto moo::ThreadPool::get_worker_count() const -> int{
+   return static_cast<int>(m_threads.size());
+}
+
+
+auto moo::ThreadPool::work() -> void{
+   unsigned int seen_generation = 0;
+   std::unique_lock lock(m_mutex);
+   while (true) {
+      m_wake.wait(lock, [&]() {return m_stopping || m_generation != seen_generation; });
+      if (m_stopping)
+         return;
+      seen_generation = m_generation;
+      lock.unlock();
+      do_tasks();
+      lock.lock();
+   }
+}
+
+
+// The task can only change in run(), after every claimed task is done
+auto moo::ThreadPool::do_tasks() -> void{
+   while (true) {
+      int task_index = 0;
+      {
+         const std::lock_guard lock(m_mutex);
+         if (m_next_task >= m_task_count)
+            return;
+         task_index = m_next_task++;
+      }
+      (*m_task)(task_index);
+
+      const std::lock_guard lock(m_mutex);
+      if (--m_tasks_left == 0)
+         m_done.notify_all();
+   }
+}
+
+
+auto moo::get_default_worker_count() -> int{
+   const int cores = static_cast<int>(std::thread::hardware_concurrency());
+   return std::max(cores - 2, 0);
+}
+
+
+TEST_CASE("ThreadPool") {
+   using namespace moo;
+   for (const int worker_count : { 0, 3 }) {
+      ThreadPool pool(worker_count);
+      for (int run = 0; run < 20; ++run) {
+         std::vector<std::atomic<int>> counts(50);
+         pool.run(static_cast<int>(counts.size()), [&](const int task_index) {
+            ++counts[task_index];
+         });
+         CHECK(std::all_of(counts.begin(), counts.end(), [](const std::atomic<int>& count) {return count == 1; }));
+      }
+   }
+}
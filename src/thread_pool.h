@@ -0,0 +1,43 @@
+#pragma once
+
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+
+namespace moo {
+
+   /// <summary>Worker threads for splitting the work of one frame. run() hands out task indices to the
+   /// workers and the calling thread, and returns when all of them are done. Without workers, the calling
+   /// thread does everything.</summary>
+   struct ThreadPool {
+      explicit ThreadPool(const int worker_count);
+      ~ThreadPool();
+      ThreadPool(const ThreadPool& copy) = delete;
+      ThreadPool& operator=(const ThreadPool& copy) = delete;
+
+      auto run(const int task_count, const std::function<void(int)>& task) -> void;
+      [[nodiscard]] auto get_worker_count() const -> int;
+
+   private:
+      auto work() -> void;
+      auto do_tasks() -> void;
+
+      std::mutex m_mutex;
+      std::condition_variable m_wake;
+      std::condition_variable m_done;
+      const std::function<void(int)>* m_task = nullptr;
+      int m_task_count = 0;
+      int m_next_task = 0;
+      int m_tasks_left = 0;
+      unsigned int m_generation = 0;
+      bool m_stopping = false;
+      std::vector<std::jthread> m_threads;
+   };
+
+   // Leaves a core for the game thread and one for the frame writer
+   [[nodiscard]] auto get_default_worker_count() -> int;
+
+}
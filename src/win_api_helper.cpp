@@ -12,6 +12,7 @@ auto moo::get_console_state() -> ConsoleState {
    ConsoleState console_state;
    GetConsoleMode(input_handle, &console_state.input_mode);
    GetConsoleMode(output_handle, &console_state.output_mode);
+   console_state.output_code_page = GetConsoleOutputCP();
 
    CONSOLE_SCREEN_BUFFER_INFO info;
    if (!GetConsoleScreenBufferInfo(output_handle, &info)) {
@@ -32,6 +33,7 @@ auto moo::set_console_state(const ConsoleState& console_state) -> void{
 
    SetConsoleMode(input_handle, console_state.input_mode);
    SetConsoleMode(output_handle, console_state.output_mode);
+   SetConsoleOutputCP(console_state.output_code_page);
    SetConsoleTextAttribute(output_handle, console_state.output_wattributes);
    SetConsoleCursorInfo(output_handle, &console_state.cursor_info);
 }
@@ -80,6 +82,15 @@ void moo::enable_vt_mode(HANDLE output_handle){
 }
 
 
+// The frame strings are UTF-8 bytes, so the console has to interpret them that way
+void moo::enable_utf8_output(){
+   if (!SetConsoleOutputCP(CP_UTF8)) {
+      auto e = GetLastError();
+      std::cout << "error " << e << "\n";
+   }
+}
+
+
 auto moo::get_window_rect() -> Rect{
    RECT window_rect;
    GetWindowRect(GetConsoleWindow(), reinterpret_cast<RECT*>(&window_rect));
@@ -125,6 +136,13 @@ void moo::write(HANDLE& output_handle, const std::wstring& str){
 }
 
 
+void moo::write(HANDLE& output_handle, const std::string_view utf8_str){
+   ZoneScopedC(0x808080);
+   LPDWORD chars_written = 0;
+   WriteConsoleA(output_handle, utf8_str.data(), static_cast<DWORD>(utf8_str.length()), chars_written, 0);
+}
+
+
 auto moo::get_console_buffer() -> std::optional<std::vector<CHAR_INFO>> {
    HANDLE hStdout = GetStdHandle(STD_OUTPUT_HANDLE);
    std::vector<CHAR_INFO> ch_buffer(static_rows * static_columns);
@@ -6,6 +6,7 @@
 
 #include <iostream>
 #include <optional>
+#include <string_view>
 #include <vector>
 
 namespace moo {
@@ -14,6 +15,7 @@ namespace moo {
 
    struct ConsoleState {
       DWORD input_mode, output_mode;
+      UINT output_code_page;
       short output_wattributes;
       CONSOLE_CURSOR_INFO cursor_info;
    };
@@ -24,6 +26,7 @@ namespace moo {
    auto set_cursor_top_left(HANDLE output_handle) -> void;
    void disable_console_cursor();
    void enable_vt_mode(HANDLE output_handle);
+   void enable_utf8_output();
    [[nodiscard]] auto get_window_rect() -> Rect;
 
    bool UnadjustWindowRectEx(
@@ -36,6 +39,7 @@ namespace moo {
    void disable_selection();
 
    void write(HANDLE& output_handle, const std::wstring& str);
+   void write(HANDLE& output_handle, const std::string_view utf8_str);
    [[nodiscard]] auto get_console_buffer() -> std::optional<std::vector<CHAR_INFO>>;
 
 }
\ No newline at end of file
@@ -0,0 +1,101 @@
+#ifdef _WIN32
+
+#include "terminal.h"
+
+#include "cc.h"
+#include "win_api_helper.h"
+
+#include <Tracy.hpp>
+
+
+struct moo::Terminal::State {
+   HANDLE output_handle;
+   ConsoleState initial_console_state;
+   bool restored = false;
+};
+
+
+auto moo::get_terminal_size() -> std::optional<TerminalSize>{
+   CONSOLE_SCREEN_BUFFER_INFO csbi;
+   if (GetConsoleScreenBufferInfo(GetStdHandle(STD_OUTPUT_HANDLE), &csbi) == 0)
+      return std::nullopt;
+   return TerminalSize{
+      csbi.srWindow.Bottom - csbi.srWindow.Top + 1,
+      csbi.srWindow.Right - csbi.srWindow.Left + 1
+   };
+}
+
+
+moo::Terminal::Terminal()
+   : m_state(std::make_unique<State>(State{ GetStdHandle(STD_OUTPUT_HANDLE), get_console_state() }))
+{
+   disable_console_cursor();
+   enable_vt_mode(m_state->output_handle);
+   enable_utf8_output();
+   disable_selection();
+}
+
+
+moo::Terminal::~Terminal() {
+   restore();
+}
+
+
+auto moo::Terminal::write(const std::string_view utf8_str) -> void{
+   moo::write(m_state->output_handle, utf8_str);
+}
+
+
+auto moo::Terminal::clear_screen() -> void{
+   moo::clear_screen();
+}
+
+
+auto moo::Terminal::restore() -> void{
+   if (m_state->restored)
+      return;
+   set_console_state(m_state->initial_console_state);
+   m_state->restored = true;
+}
+
+
+// The console has processed the output once WriteConsole() returns, so there's nothing to wait for
+auto moo::Terminal::get_cursor_position() -> std::optional<LineCoord>{
+   CONSOLE_SCREEN_BUFFER_INFO info;
+   if (GetConsoleScreenBufferInfo(m_state->output_handle, &info) == 0)
+      return std::nullopt;
+   return LineCoord{
+      info.dwCursorPosition.Y - info.srWindow.Top,
+      info.dwCursorPosition.X - info.srWindow.Left
+   };
+}
+
+
+// Key states are global, so this sees keys even when the console isn't focused. The mouse position is
+// relative to the console window, which can move between frames.
+auto moo::Terminal::read_input() -> Input{
+   ZoneScopedC(0x0000ff);
+   Rect window_rect = get_window_rect();
+   POINT cursor_pos;
+   GetCursorPos(&cursor_pos);
+   const ScreenCoord mouse_pos{
+      1.0 * (cursor_pos.x - window_rect.top_left.j) / (window_rect.get_width() - 20),
+      1.0 * (cursor_pos.y - window_rect.top_left.i) / window_rect.get_height()
+   };
+
+   const auto is_pressed = [](const int key) {
+      return GetKeyState(key) < 0;
+   };
+   return Input{
+      is_pressed(VK_ESCAPE),
+      is_pressed(VK_SPACE),
+      is_pressed(VK_LBUTTON),
+      is_pressed(0x41) || is_pressed(VK_LEFT), // A
+      is_pressed(0x44) || is_pressed(VK_RIGHT), // D
+      is_pressed(0x57) || is_pressed(VK_UP), // W
+      is_pressed(0x53) || is_pressed(VK_DOWN), // S
+      mouse_pos
+   };
+}
+
+#endif // _WIN32